@@ -0,0 +1,571 @@
+#include "Benchmark.h"
+#include "Renderer.h"
+#include "World/Block.h"
+#include "World/ChunkMap.h"
+#include "World/Noise.h"
+#include "World/RegionStore.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+bool CameraPath_Load(CameraPath *path, const char *file) {
+  *path = (CameraPath){0};
+  FILE *f = fopen(file, "r");
+  if (!f) {
+    printf("Benchmark: could not open camera path %s\n", file);
+    return false;
+  }
+
+  int capacity = 0;
+  int lineNumber = 0;
+  char line[256];
+  while (fgets(line, sizeof(line), f)) {
+    lineNumber++;
+    char *p = line;
+    while (*p == ' ' || *p == '\t')
+      p++;
+    if (*p == '#' || *p == '\n' || *p == '\r' || *p == '\0')
+      continue;
+
+    CameraKeyframe key;
+    if (sscanf(p, "%f %f %f %f %f %f", &key.time, &key.position.x,
+               &key.position.y, &key.position.z, &key.yaw, &key.pitch) != 6) {
+      printf("Benchmark: %s:%d: expected \"time x y z yaw pitch\"\n", file,
+             lineNumber);
+      goto fail;
+    }
+    if (path->count > 0 && key.time <= path->keys[path->count - 1].time) {
+      printf("Benchmark: %s:%d: keyframe times must increase\n", file,
+             lineNumber);
+      goto fail;
+    }
+
+    if (path->count == capacity) {
+      capacity = capacity ? capacity * 2 : 16;
+      CameraKeyframe *grown = (CameraKeyframe *)realloc(
+          path->keys, capacity * sizeof(CameraKeyframe));
+      if (!grown)
+        goto fail;
+      path->keys = grown;
+    }
+    path->keys[path->count++] = key;
+  }
+  fclose(f);
+
+  if (path->count == 0) {
+    printf("Benchmark: %s has no keyframes\n", file);
+    return false;
+  }
+  return true;
+
+fail:
+  fclose(f);
+  CameraPath_Free(path);
+  return false;
+}
+
+void CameraPath_Free(CameraPath *path) {
+  free(path->keys);
+  *path = (CameraPath){0};
+}
+
+float CameraPath_Duration(const CameraPath *path) {
+  return path->keys[path->count - 1].time;
+}
+
+// Places the player on the path at time, holding the end keyframes outside
+// it. Velocity is the current segment's, since chunk streaming looks ahead
+// along it.
+void CameraPath_Apply(const CameraPath *path, float time, Player *player) {
+  int i = 1;
+  while (i < path->count - 1 && path->keys[i].time < time)
+    i++;
+  const CameraKeyframe *a = &path->keys[path->count > 1 ? i - 1 : 0];
+  const CameraKeyframe *b = &path->keys[path->count > 1 ? i : 0];
+
+  float span = b->time - a->time;
+  float t = span > 0.0f ? (time - a->time) / span : 0.0f;
+  bool moving = t >= 0.0f && t < 1.0f && span > 0.0f;
+  t = fminf(fmaxf(t, 0.0f), 1.0f);
+  vec3 delta = Vec3Subtract(b->position, a->position);
+
+  player->position = Vec3Lerp(a->position, b->position, t);
+  player->velocity =
+      moving ? Vec3Scale(delta, 1.0f / span) : (vec3){0.0f, 0.0f, 0.0f};
+  player->cam.pos = (vec3){player->position.x,
+                           player->position.y + player->eyeHeight,
+                           player->position.z};
+  player->cam.yaw = a->yaw + (b->yaw - a->yaw) * t;
+  player->cam.pitch = a->pitch + (b->pitch - a->pitch) * t;
+}
+
+static int CompareDoubles(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+// Nearest rank on an already sorted array.
+static double Percentile(const double *sorted, int count, double p) {
+  int rank = (int)ceil(p * count);
+  return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+// Sorts times in place.
+TimingSummary Benchmark_Summarize(double *times, int count) {
+  double total = 0.0;
+  for (int i = 0; i < count; i++)
+    total += times[i];
+  qsort(times, count, sizeof(double), CompareDoubles);
+  return (TimingSummary){total / count, Percentile(times, count, 0.50),
+                         Percentile(times, count, 0.95),
+                         Percentile(times, count, 0.99), times[count - 1]};
+}
+
+// Peak resident set of the whole process. On llvmpipe that includes what
+// would otherwise be GPU memory.
+long Benchmark_PeakResidentBytes(void) {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return 0;
+  return usage.ru_maxrss * 1024L;
+}
+
+static void WriteJsonString(FILE *f, const char *s) {
+  if (!s) {
+    fputs("null", f);
+    return;
+  }
+  fputc('"', f);
+  for (; *s; s++) {
+    if (*s == '"' || *s == '\\')
+      fprintf(f, "\\%c", *s);
+    else if ((unsigned char)*s < 0x20)
+      fprintf(f, "\\u%04x", *s);
+    else
+      fputc(*s, f);
+  }
+  fputc('"', f);
+}
+
+static void WriteTiming(FILE *f, const char *name, TimingSummary t) {
+  fprintf(f,
+          "  \"%s\": {\"avg\": %.4f, \"p50\": %.4f, \"p95\": %.4f, "
+          "\"p99\": %.4f, \"max\": %.4f},\n",
+          name, t.avg, t.p50, t.p95, t.p99, t.max);
+}
+
+bool Benchmark_WriteReport(const BenchmarkReport *r, const char *file) {
+  FILE *f = fopen(file, "w");
+  if (!f) {
+    printf("Benchmark: could not write %s\n", file);
+    return false;
+  }
+
+  fputs("{\n  \"renderer\": ", f);
+  WriteJsonString(f, r->renderer);
+  fputs(",\n  \"path\": ", f);
+  WriteJsonString(f, r->path);
+  fprintf(f,
+          ",\n  \"seed\": %d,\n  \"width\": %d,\n  \"height\": %d,\n"
+          "  \"frames\": %d,\n  \"timestep\": %.6f,\n  \"seconds\": %.3f,\n",
+          r->seed, r->width, r->height, r->frames, r->timestep, r->seconds);
+  WriteTiming(f, "frameMs", r->frameMs);
+  WriteTiming(f, "updateMs", r->updateMs);
+  WriteTiming(f, "renderMs", r->renderMs);
+  WriteTiming(f, "submitMs", r->submitMs);
+  fprintf(f,
+          "  \"chunksGenerated\": %ld,\n  \"chunksGeneratedPerSec\": %.2f,\n"
+          "  \"chunksMeshed\": %ld,\n  \"chunksMeshedPerSec\": %.2f,\n"
+          "  \"trianglesSubmitted\": %ld,\n  \"trianglesPerFrame\": %.1f,\n"
+          "  \"peakResidentBytes\": %ld,\n  \"arenaBytes\": %ld,\n",
+          r->chunksGenerated, r->chunksGenerated / r->seconds, r->chunksMeshed,
+          r->chunksMeshed / r->seconds, r->trianglesSubmitted,
+          (double)r->trianglesSubmitted / r->frames, r->peakResidentBytes,
+          r->arenaBytes);
+  fputs("  \"memory\": {", f);
+  for (int i = 0; i < MEM_TAG_COUNT; i++) {
+    fprintf(f, "%s\n    ", i ? "," : "");
+    WriteJsonString(f, Memory_TagName((MemoryTag)i));
+    fprintf(f, ": {\"live\": %zu, \"peak\": %zu}", r->memory[i].live,
+            r->memory[i].peak);
+  }
+  fputs("\n  }\n}\n", f);
+
+  bool ok = !ferror(f);
+  if (fclose(f) != 0)
+    ok = false;
+  if (!ok)
+    printf("Benchmark: error writing %s\n", file);
+  return ok;
+}
+
+static double MicroNowNs(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// The fixed slot array ChunkMap replaced, scanned the way it was.
+typedef struct {
+  int chunkX;
+  int chunkZ;
+  bool loaded;
+} ScanSlot;
+
+#define MAP_BENCH_LOOKUPS 2000000
+
+// Random lookups over a square of resident chunks, against a linear scan of
+// the same chunks.
+static bool BenchmarkChunkMap(void) {
+  static Chunk resident;
+  printf("  chunks   hash map   linear scan\n");
+  for (int count = 64; count <= 4096; count *= 4) {
+    int side = (int)ceil(sqrt(count));
+    ChunkMap map;
+    ScanSlot *slots = (ScanSlot *)calloc(count, sizeof(ScanSlot));
+    if (!slots || !ChunkMap_Init(&map, 64)) {
+      free(slots);
+      return false;
+    }
+    for (int i = 0; i < count; i++) {
+      int x = i % side - side / 2, z = i / side - side / 2;
+      ChunkMap_Insert(&map, x, z, &resident);
+      slots[i] = (ScanSlot){x, z, true};
+    }
+
+    volatile long hits = 0;
+    unsigned int r = 1;
+    double start = MicroNowNs();
+    for (int i = 0; i < MAP_BENCH_LOOKUPS; i++) {
+      r = r * 1103515245u + 12345u;
+      int x = (int)((r >> 8) % side) - side / 2;
+      int z = (int)((r >> 16) % side) - side / 2;
+      hits += ChunkMap_Get(&map, x, z) != NULL;
+    }
+    double mapNs = (MicroNowNs() - start) / MAP_BENCH_LOOKUPS;
+
+    // Fewer scans as the map grows, so each size takes about as long.
+    int scans = MAP_BENCH_LOOKUPS / (count / 64);
+    start = MicroNowNs();
+    for (int i = 0; i < scans; i++) {
+      r = r * 1103515245u + 12345u;
+      int x = (int)((r >> 8) % side) - side / 2;
+      int z = (int)((r >> 16) % side) - side / 2;
+      for (int j = 0; j < count; j++) {
+        if (slots[j].loaded && slots[j].chunkX == x && slots[j].chunkZ == z) {
+          hits++;
+          break;
+        }
+      }
+    }
+    double scanNs = (MicroNowNs() - start) / scans;
+    printf("  %6d %8.1f ns %10.1f ns\n", count, mapNs, scanNs);
+
+    ChunkMap_Free(&map);
+    free(slots);
+  }
+  return true;
+}
+
+#define MICRO_SEED 3
+#define MICRO_VOXEL_SIZE 0.2f
+#define MESH_BENCH_RADIUS 2
+#define MESH_BENCH_REPS 20
+
+// Meshes every section of the 5x5 chunks around the origin with each
+// mesher, best of MESH_BENCH_REPS per chunk. The neighbourhoods are built
+// once per chunk outside the timed loop; their cost is reported on its own.
+static bool BenchmarkMeshing(void) {
+  InitWorldSeed(MICRO_SEED);
+  ChunkMesher previous = GetChunkMesher();
+
+  // One ring more than is meshed, so the border sections see real
+  // neighbours.
+  enum { SIDE = 2 * MESH_BENCH_RADIUS + 3, MESHED = SIDE - 2 };
+  Chunk *chunks[SIDE * SIDE] = {0};
+  ChunkMap map;
+  ChunkNeighborhood *nb = (ChunkNeighborhood *)Memory_Alloc(
+      MEM_TAG_MESH_SCRATCH, CHUNK_SECTIONS * sizeof(ChunkNeighborhood));
+  bool mapReady = nb && ChunkMap_Init(&map, SIDE * SIDE);
+  bool ok = mapReady;
+  float chunkWorldSize = CHUNK_SIZE * MICRO_VOXEL_SIZE;
+  for (int i = 0; i < SIDE * SIDE && ok; i++) {
+    int x = i % SIDE - SIDE / 2, z = i / SIDE - SIDE / 2;
+    chunks[i] = CreateChunk(
+        (vec3){x * chunkWorldSize, 0.0f, z * chunkWorldSize}, CHUNK_SIZE,
+        MICRO_VOXEL_SIZE);
+    ok = chunks[i] && ChunkMap_Insert(&map, x, z, chunks[i]);
+  }
+
+  double buildNs = 0.0;
+  double meshNs[2] = {0.0, 0.0};
+  long quads[2] = {0, 0};
+  for (int i = 0; i < MESHED * MESHED && ok; i++) {
+    const Chunk *c = ChunkMap_Get(&map, i % MESHED - MESHED / 2,
+                                  i / MESHED - MESHED / 2);
+    double start = MicroNowNs();
+    for (int s = 0; s < CHUNK_SECTIONS; s++)
+      BuildChunkNeighborhood(&map, c, s, &nb[s]);
+    buildNs += MicroNowNs() - start;
+
+    for (int m = 0; m < 2 && ok; m++) {
+      SetChunkMesher((ChunkMesher)m);
+      double best = 0.0;
+      for (int rep = 0; rep < MESH_BENCH_REPS && ok; rep++) {
+        start = MicroNowNs();
+        for (int s = 0; s < CHUNK_SECTIONS && ok; s++) {
+          ChunkMeshData mesh;
+          ok = GenerateChunkMeshData(&nb[s], CHUNK_SIZE, MICRO_VOXEL_SIZE,
+                                     &mesh);
+          if (ok && rep == 0)
+            quads[m] += (long)(mesh.count / 4);
+          if (ok)
+            FreeChunkMeshData(&mesh);
+        }
+        double elapsed = MicroNowNs() - start;
+        if (rep == 0 || elapsed < best)
+          best = elapsed;
+      }
+      meshNs[m] += best;
+    }
+  }
+
+  SetChunkMesher(previous);
+  for (int i = 0; i < SIDE * SIDE; i++)
+    if (chunks[i])
+      FreeChunk(chunks[i]);
+  if (mapReady)
+    ChunkMap_Free(&map);
+  Memory_Free(MEM_TAG_MESH_SCRATCH, nb);
+  if (!ok) {
+    printf("Benchmark: could not mesh the test chunks\n");
+    return false;
+  }
+
+  const int count = MESHED * MESHED;
+  printf("  %d chunks, seed %d, best of %d\n", count, MICRO_SEED,
+         MESH_BENCH_REPS);
+  printf("  neighbourhoods  %8.1f us per chunk\n", buildNs / count / 1e3);
+  const char *names[2] = {"naive", "greedy"};
+  for (int m = 0; m < 2; m++)
+    printf("  %-6s mesher   %8.1f us per chunk  %8ld quads\n", names[m],
+           meshNs[m] / count / 1e3, quads[m]);
+  return true;
+}
+
+#define NOISE_BENCH_ROWS 2000
+#define NOISE_BENCH_OCTAVES 4
+#define NOISE_BENCH_REPS 5
+
+// Fills a 32x32 grid of heightmap noise per row, the way terrain generation
+// batches it, on every backend the CPU supports. Each backend's first row is
+// also checked against the scalar perlinNoise, which it must match exactly.
+static bool BenchmarkNoise(void) {
+  enum { GRID = CHUNK_SIZE * CHUNK_SIZE };
+  const float scale = 0.01f, persistence = 0.5f;
+  float xs[GRID], zs[GRID], out[GRID];
+  NoiseBackend previous = Noise_GetBackend();
+
+  printf("  backend   octave samples/s   fBm samples/s   mismatches\n");
+  for (int b = NOISE_BACKEND_SCALAR; b <= NOISE_BACKEND_AVX2; b++) {
+    Noise_SetBackend((NoiseBackend)b);
+    if (Noise_GetBackend() != (NoiseBackend)b)
+      continue;
+
+    for (int i = 0; i < GRID; i++) {
+      xs[i] = (float)(i / CHUNK_SIZE);
+      zs[i] = (float)(i % CHUNK_SIZE);
+    }
+    Noise_PerlinBatch(xs, zs, GRID, scale, MICRO_SEED, NOISE_BENCH_OCTAVES,
+                      persistence, out);
+    int mismatches = 0;
+    for (int i = 0; i < GRID; i++) {
+      float expected = perlinNoise(xs[i] * scale, zs[i] * scale, MICRO_SEED,
+                                   NOISE_BENCH_OCTAVES, persistence);
+      mismatches += memcmp(&expected, &out[i], sizeof(float)) != 0;
+    }
+
+    double best = 0.0;
+    for (int rep = 0; rep < NOISE_BENCH_REPS; rep++) {
+      double start = MicroNowNs();
+      for (int row = 0; row < NOISE_BENCH_ROWS; row++) {
+        for (int i = 0; i < GRID; i++)
+          xs[i] = (float)(row * CHUNK_SIZE + i / CHUNK_SIZE);
+        Noise_PerlinBatch(xs, zs, GRID, scale, MICRO_SEED,
+                          NOISE_BENCH_OCTAVES, persistence, out);
+      }
+      double elapsed = MicroNowNs() - start;
+      if (rep == 0 || elapsed < best)
+        best = elapsed;
+    }
+    double samples = (double)NOISE_BENCH_ROWS * GRID;
+    printf("  %-7s %12.1f M %14.1f M %12d\n",
+           Noise_BackendName((NoiseBackend)b),
+           samples * NOISE_BENCH_OCTAVES / best * 1e3, samples / best * 1e3,
+           mismatches);
+    if (mismatches) {
+      Noise_SetBackend(previous);
+      return false;
+    }
+  }
+  Noise_SetBackend(previous);
+  return true;
+}
+
+#define LOAD_BENCH_SIDE 12
+#define LOAD_BENCH_CHUNKS (LOAD_BENCH_SIDE * LOAD_BENCH_SIDE)
+
+// Calls f on every region file in directory, by path.
+static void ForEachRegionFile(const char *directory,
+                              void (*f)(const char *path)) {
+  DIR *dir = opendir(directory);
+  if (!dir)
+    return;
+  struct dirent *entry;
+  char path[512];
+  while ((entry = readdir(dir))) {
+    if (strncmp(entry->d_name, "r.", 2) != 0)
+      continue;
+    snprintf(path, sizeof(path), "%s/%s", directory, entry->d_name);
+    f(path);
+  }
+  closedir(dir);
+}
+
+static void DropFromPageCache(const char *path) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return;
+  posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  close(fd);
+}
+
+static void RemoveFile(const char *path) { unlink(path); }
+
+// Times RegionStore_Load of every chunk in the store, in microseconds.
+// Returns false if any chunk is missing.
+static bool TimeRegionLoads(RegionStore *store, double *us) {
+  float chunkWorldSize = CHUNK_SIZE * MICRO_VOXEL_SIZE;
+  for (int i = 0; i < LOAD_BENCH_CHUNKS; i++) {
+    int x = i % LOAD_BENCH_SIDE - LOAD_BENCH_SIDE / 2;
+    int z = i / LOAD_BENCH_SIDE - LOAD_BENCH_SIDE / 2;
+    Chunk *c = AllocateChunk(
+        (vec3){x * chunkWorldSize, 0.0f, z * chunkWorldSize}, x, z,
+        MICRO_VOXEL_SIZE);
+    if (!c)
+      return false;
+    double start = MicroNowNs();
+    ChunkState state = RegionStore_Load(store, c);
+    us[i] = (MicroNowNs() - start) / 1e3;
+    FreeChunk(c);
+    if (state == CHUNK_EMPTY)
+      return false;
+  }
+  return true;
+}
+
+static void PrintMicroTiming(const char *name, double *us) {
+  TimingSummary t = Benchmark_Summarize(us, LOAD_BENCH_CHUNKS);
+  printf("  %-22s %8.1f %8.1f %8.1f %8.1f us\n", name, t.avg, t.p50, t.p99,
+         t.max);
+}
+
+// Generates a square of chunks into a region store in a temporary
+// directory, then loads them back from disk: once after dropping the region
+// files from the page cache and once warm. The store is closed before the
+// cold pass so its mappings don't keep the pages resident.
+static bool BenchmarkRegionLoad(void) {
+  static double createUs[LOAD_BENCH_CHUNKS], coldUs[LOAD_BENCH_CHUNKS],
+      warmUs[LOAD_BENCH_CHUNKS];
+  char directory[] = "/tmp/voxel-bench-XXXXXX";
+  if (!mkdtemp(directory)) {
+    printf("Benchmark: could not create a temporary directory\n");
+    return false;
+  }
+  InitWorldSeed(MICRO_SEED);
+
+  RegionStore store;
+  bool open = RegionStore_Open(&store, directory, MICRO_SEED);
+  bool ok = open;
+  float chunkWorldSize = CHUNK_SIZE * MICRO_VOXEL_SIZE;
+  for (int i = 0; i < LOAD_BENCH_CHUNKS && ok; i++) {
+    int x = i % LOAD_BENCH_SIDE - LOAD_BENCH_SIDE / 2;
+    int z = i / LOAD_BENCH_SIDE - LOAD_BENCH_SIDE / 2;
+    double start = MicroNowNs();
+    Chunk *c = CreateChunk(
+        (vec3){x * chunkWorldSize, 0.0f, z * chunkWorldSize}, CHUNK_SIZE,
+        MICRO_VOXEL_SIZE);
+    createUs[i] = (MicroNowNs() - start) / 1e3;
+    ok = c && RegionStore_Save(&store, c);
+    if (c)
+      FreeChunk(c);
+  }
+  if (open)
+    RegionStore_Close(&store);
+
+  if (ok) {
+    ForEachRegionFile(store.directory, DropFromPageCache);
+    open = RegionStore_Open(&store, directory, MICRO_SEED);
+    ok = open && TimeRegionLoads(&store, coldUs) &&
+         TimeRegionLoads(&store, warmUs);
+    if (open)
+      RegionStore_Close(&store);
+  }
+
+  ForEachRegionFile(store.directory, RemoveFile);
+  rmdir(store.directory);
+  rmdir(directory);
+  if (!ok) {
+    printf("Benchmark: could not store and reload the test chunks\n");
+    return false;
+  }
+
+  printf("  %d chunks, seed %d%*s%8s %8s %8s %8s\n", LOAD_BENCH_CHUNKS,
+         MICRO_SEED, 5, "", "mean", "p50", "p99", "max");
+  PrintMicroTiming("region load, cold", coldUs);
+  PrintMicroTiming("region load, warm", warmUs);
+  PrintMicroTiming("CreateChunk", createUs);
+  return true;
+}
+
+typedef struct {
+  const char *name;
+  const char *description;
+  bool (*run)(void);
+} Microbenchmark;
+
+static const Microbenchmark g_microbenchmarks[] = {
+    {"map", "chunk map lookups from 64 to 4096 chunks", BenchmarkChunkMap},
+    {"mesh", "naive and greedy meshing time per chunk", BenchmarkMeshing},
+    {"noise", "heightmap noise samples per second per backend",
+     BenchmarkNoise},
+    {"load", "region store load against CreateChunk per chunk",
+     BenchmarkRegionLoad},
+};
+
+#define MICROBENCHMARK_COUNT                                                   \
+  (int)(sizeof(g_microbenchmarks) / sizeof(g_microbenchmarks[0]))
+
+void Benchmark_ListMicro(void) {
+  for (int i = 0; i < MICROBENCHMARK_COUNT; i++)
+    printf("  %-6s %s\n", g_microbenchmarks[i].name,
+           g_microbenchmarks[i].description);
+}
+
+bool Benchmark_RunMicro(const char *name) {
+  for (int i = 0; i < MICROBENCHMARK_COUNT; i++) {
+    if (strcmp(g_microbenchmarks[i].name, name) != 0)
+      continue;
+    printf("Benchmark: %s, %s\n", name, g_microbenchmarks[i].description);
+    return g_microbenchmarks[i].run();
+  }
+  printf("Benchmark: no microbenchmark named %s, choose one of\n", name);
+  Benchmark_ListMicro();
+  return false;
+}
@@ -0,0 +1,69 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include "Memory.h"
+#include "Player/Player.h"
+#include "utils/MathUtil.h"
+#include <stdbool.h>
+
+// One line of a camera path file: "time x y z yaw pitch", time in seconds
+// and angles in degrees. Blank lines and lines starting with # are skipped.
+typedef struct {
+  float time;
+  vec3 position;
+  float yaw;
+  float pitch;
+} CameraKeyframe;
+
+// Keyframes in increasing time order, interpolated linearly.
+typedef struct {
+  CameraKeyframe *keys;
+  int count;
+} CameraPath;
+
+typedef struct {
+  double avg;
+  double p50;
+  double p95;
+  double p99;
+  double max;
+} TimingSummary;
+
+typedef struct {
+  const char *renderer;
+  const char *path; // NULL for the built-in flight
+  int seed;
+  int width;
+  int height;
+  int frames;
+  float timestep;
+  double seconds;
+
+  TimingSummary frameMs;
+  TimingSummary updateMs;
+  TimingSummary renderMs;
+  TimingSummary submitMs;
+
+  long chunksGenerated;
+  long chunksMeshed;
+  long trianglesSubmitted;
+  long peakResidentBytes;
+  long arenaBytes;
+  MemoryTagStats memory[MEM_TAG_COUNT];
+} BenchmarkReport;
+
+bool CameraPath_Load(CameraPath *path, const char *file);
+void CameraPath_Free(CameraPath *path);
+float CameraPath_Duration(const CameraPath *path);
+void CameraPath_Apply(const CameraPath *path, float time, Player *player);
+
+TimingSummary Benchmark_Summarize(double *times, int count);
+long Benchmark_PeakResidentBytes(void);
+bool Benchmark_WriteReport(const BenchmarkReport *report, const char *file);
+
+// Microbenchmarks of single subsystems, run by name with --bench. They print
+// their own results and need no GL context.
+bool Benchmark_RunMicro(const char *name);
+void Benchmark_ListMicro(void);
+
+#endif
@@ -0,0 +1,448 @@
+#include "Headless.h"
+#include "Benchmark.h"
+#include "Memory.h"
+#include "Profiler.h"
+#include "Scene.h"
+#include "Verify.h"
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GL/glew.h>
+#include <SDL3/SDL.h>
+#include <SDL3_image/SDL_image.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HEADLESS_TIMESTEP (1.0f / 60.0f)
+#define HEADLESS_DEFAULT_FRAMES 600
+// The world seed 0 means "pick one from the clock", which a benchmark must
+// never do.
+#define HEADLESS_DEFAULT_SEED 3
+#define HEADLESS_FLY_SPEED 6.0f
+#define HEADLESS_FLY_HEIGHT 8.0f
+
+typedef struct {
+  EGLDisplay display;
+  EGLContext context;
+  EGLSurface surface;
+} HeadlessContext;
+
+typedef struct {
+  GLuint framebuffer;
+  GLuint color;
+  GLuint depth;
+} HeadlessTarget;
+
+static void PrintUsage(void) {
+  printf("Usage: main --headless [--frames N] [--width W] [--height H]\n"
+         "                      [--seed S] [--path FILE] [--report FILE]\n"
+         "                      [--trace FILE]\n"
+         "                      [--dump DIR] [--dump-every K]\n"
+         "       main --verify-chunks | --verify-meshers\n"
+         "       main --bench NAME, NAME being one of\n");
+  Benchmark_ListMicro();
+}
+
+bool Headless_ParseArgs(int argc, char **argv, HeadlessOptions *options) {
+  *options = (HeadlessOptions){
+      .frames = 0, .width = 1280, .height = 720,
+      .seed = HEADLESS_DEFAULT_SEED, .dumpEvery = 60};
+
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+    if (strcmp(arg, "--headless") == 0)
+      continue;
+    if (strcmp(arg, "--verify-chunks") == 0) {
+      options->verifyChunks = true;
+      continue;
+    }
+    if (strcmp(arg, "--verify-meshers") == 0) {
+      options->verifyMeshers = true;
+      continue;
+    }
+
+    if (!value) {
+      printf("Headless: missing value for %s\n", arg);
+      PrintUsage();
+      return false;
+    }
+    if (strcmp(arg, "--frames") == 0)
+      options->frames = atoi(value);
+    else if (strcmp(arg, "--width") == 0)
+      options->width = atoi(value);
+    else if (strcmp(arg, "--height") == 0)
+      options->height = atoi(value);
+    else if (strcmp(arg, "--seed") == 0)
+      options->seed = atoi(value);
+    else if (strcmp(arg, "--path") == 0)
+      options->pathFile = value;
+    else if (strcmp(arg, "--report") == 0)
+      options->reportFile = value;
+    else if (strcmp(arg, "--trace") == 0)
+      options->traceFile = value;
+    else if (strcmp(arg, "--dump") == 0)
+      options->dumpDirectory = value;
+    else if (strcmp(arg, "--dump-every") == 0)
+      options->dumpEvery = atoi(value);
+    else if (strcmp(arg, "--bench") == 0)
+      options->bench = value;
+    else {
+      printf("Headless: unknown option %s\n", arg);
+      PrintUsage();
+      return false;
+    }
+    i++;
+  }
+
+#if !PROFILER_ENABLED
+  if (options->traceFile)
+    printf("Headless: built without the profiler, --trace is ignored\n");
+#endif
+  if (options->frames < 0 || options->width <= 0 || options->height <= 0 ||
+      options->dumpEvery <= 0) {
+    printf("Headless: frames, size and dump interval must be positive\n");
+    return false;
+  }
+  if (options->seed == 0) {
+    printf("Headless: seed 0 picks a random world, use a nonzero seed\n");
+    return false;
+  }
+  return true;
+}
+
+// Prefers Mesa's surfaceless platform, which needs no X or Wayland server at
+// all; otherwise falls back to the default display with a tiny pbuffer.
+static bool CreateContext(HeadlessContext *ctx) {
+  *ctx = (HeadlessContext){EGL_NO_DISPLAY, EGL_NO_CONTEXT, EGL_NO_SURFACE};
+
+  PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+      (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress(
+          "eglGetPlatformDisplayEXT");
+  if (getPlatformDisplay)
+    ctx->display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,
+                                      EGL_DEFAULT_DISPLAY, NULL);
+  if (ctx->display == EGL_NO_DISPLAY)
+    ctx->display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  if (ctx->display == EGL_NO_DISPLAY ||
+      !eglInitialize(ctx->display, NULL, NULL)) {
+    printf("Headless: no EGL display\n");
+    return false;
+  }
+  if (!eglBindAPI(EGL_OPENGL_API)) {
+    printf("Headless: EGL has no desktop OpenGL\n");
+    eglTerminate(ctx->display);
+    return false;
+  }
+
+  const char *extensions = eglQueryString(ctx->display, EGL_EXTENSIONS);
+  bool surfaceless =
+      extensions && strstr(extensions, "EGL_KHR_surfaceless_context");
+
+  EGLint configAttribs[] = {EGL_SURFACE_TYPE,
+                            surfaceless ? EGL_DONT_CARE : EGL_PBUFFER_BIT,
+                            EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+  EGLint contextAttribs[] = {EGL_CONTEXT_MAJOR_VERSION,
+                             3,
+                             EGL_CONTEXT_MINOR_VERSION,
+                             3,
+                             EGL_CONTEXT_OPENGL_PROFILE_MASK,
+                             EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                             EGL_NONE};
+  EGLint pbufferAttribs[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+
+  EGLConfig config;
+  EGLint configCount = 0;
+  if (!eglChooseConfig(ctx->display, configAttribs, &config, 1,
+                       &configCount) ||
+      configCount == 0) {
+    printf("Headless: no EGL config for desktop OpenGL\n");
+    eglTerminate(ctx->display);
+    return false;
+  }
+
+  ctx->context =
+      eglCreateContext(ctx->display, config, EGL_NO_CONTEXT, contextAttribs);
+  if (ctx->context == EGL_NO_CONTEXT) {
+    printf("Headless: could not create an OpenGL 3.3 core context\n");
+    eglTerminate(ctx->display);
+    return false;
+  }
+  if (!surfaceless)
+    ctx->surface =
+        eglCreatePbufferSurface(ctx->display, config, pbufferAttribs);
+
+  if (!eglMakeCurrent(ctx->display, ctx->surface, ctx->surface,
+                      ctx->context)) {
+    printf("Headless: could not make the context current\n");
+    if (ctx->surface != EGL_NO_SURFACE)
+      eglDestroySurface(ctx->display, ctx->surface);
+    eglDestroyContext(ctx->display, ctx->context);
+    eglTerminate(ctx->display);
+    return false;
+  }
+  return true;
+}
+
+static void DestroyContext(HeadlessContext *ctx) {
+  eglMakeCurrent(ctx->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+  if (ctx->surface != EGL_NO_SURFACE)
+    eglDestroySurface(ctx->display, ctx->surface);
+  eglDestroyContext(ctx->display, ctx->context);
+  eglTerminate(ctx->display);
+}
+
+static bool CreateTarget(HeadlessTarget *target, int width, int height) {
+  glGenRenderbuffers(1, &target->color);
+  glBindRenderbuffer(GL_RENDERBUFFER, target->color);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+  Memory_TrackGL(MEM_GL_RENDERBUFFER, target->color, MEM_TAG_GPU_TEXTURE,
+                 (size_t)width * height * 4);
+  glGenRenderbuffers(1, &target->depth);
+  glBindRenderbuffer(GL_RENDERBUFFER, target->depth);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+  // Depth 24 is padded to four bytes a pixel.
+  Memory_TrackGL(MEM_GL_RENDERBUFFER, target->depth, MEM_TAG_GPU_TEXTURE,
+                 (size_t)width * height * 4);
+
+  glGenFramebuffers(1, &target->framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, target->framebuffer);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                            GL_RENDERBUFFER, target->color);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                            GL_RENDERBUFFER, target->depth);
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+    printf("Headless: %dx%d framebuffer is incomplete\n", width, height);
+    return false;
+  }
+  glViewport(0, 0, width, height);
+  return true;
+}
+
+static void FreeTarget(HeadlessTarget *target) {
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glDeleteFramebuffers(1, &target->framebuffer);
+  Memory_UntrackGL(MEM_GL_RENDERBUFFER, target->color);
+  Memory_UntrackGL(MEM_GL_RENDERBUFFER, target->depth);
+  glDeleteRenderbuffers(1, &target->color);
+  glDeleteRenderbuffers(1, &target->depth);
+}
+
+// Flies straight along +z from the spawn point, just above most of the
+// terrain, while panning the view from side to side so both streaming
+// priorities and culling change every frame.
+static void MoveScriptedCamera(Player *player, vec3 start, float time) {
+  player->position = (vec3){start.x, HEADLESS_FLY_HEIGHT,
+                            start.z + HEADLESS_FLY_SPEED * time};
+  player->velocity = (vec3){0.0f, 0.0f, HEADLESS_FLY_SPEED};
+  player->cam.pos = (vec3){player->position.x,
+                           player->position.y + player->eyeHeight,
+                           player->position.z};
+  player->cam.yaw = 90.0f + 40.0f * sinf(time * 0.5f);
+  player->cam.pitch = -15.0f;
+}
+
+static void DumpFrame(const char *directory, int frame, int width, int height,
+                      uint8_t *pixels) {
+  glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+  SDL_Surface *surface = SDL_CreateSurfaceFrom(
+      width, height, SDL_PIXELFORMAT_RGBA32, pixels, width * 4);
+  if (!surface) {
+    printf("Headless: could not wrap frame %d: %s\n", frame, SDL_GetError());
+    return;
+  }
+  // GL rows start at the bottom.
+  SDL_FlipSurface(surface, SDL_FLIP_VERTICAL);
+
+  char path[512];
+  snprintf(path, sizeof(path), "%s/frame_%05d.png", directory, frame);
+  if (!IMG_SavePNG(surface, path))
+    printf("Headless: could not write %s: %s\n", path, SDL_GetError());
+  SDL_DestroySurface(surface);
+}
+
+static void PrintTiming(const char *label, TimingSummary t) {
+  printf("  %-7s avg %7.3f  p50 %7.3f  p95 %7.3f  p99 %7.3f  max %7.3f ms\n",
+         label, t.avg, t.p50, t.p95, t.p99, t.max);
+}
+
+int Headless_Run(const HeadlessOptions *options) {
+  int width = options->width, height = options->height;
+  if (options->verifyChunks || options->verifyMeshers) {
+    bool ok = true;
+    if (options->verifyChunks)
+      ok = Verify_Chunks() && ok;
+    if (options->verifyMeshers)
+      ok = Verify_Meshers() && ok;
+    return ok ? 0 : 1;
+  }
+  if (options->bench)
+    return Benchmark_RunMicro(options->bench) ? 0 : 1;
+
+  PROFILE_THREAD("Main");
+  HeadlessContext ctx;
+  if (!CreateContext(&ctx))
+    return 1;
+
+  glewExperimental = GL_TRUE;
+  GLenum glewStatus = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+  // GLX builds of GLEW load every GL entry point before finding there is no
+  // X display; only the GLX extensions are missing, which we never use.
+  if (glewStatus == GLEW_ERROR_NO_GLX_DISPLAY)
+    glewStatus = GLEW_OK;
+#endif
+  if (glewStatus != GLEW_OK) {
+    printf("Headless: GLEW init failed\n");
+    DestroyContext(&ctx);
+    return 1;
+  }
+
+  CameraPath path = {0};
+  if (options->pathFile && !CameraPath_Load(&path, options->pathFile)) {
+    DestroyContext(&ctx);
+    return 1;
+  }
+  int frames = options->frames;
+  if (frames == 0)
+    frames = path.count > 0
+                 ? (int)ceilf(CameraPath_Duration(&path) / HEADLESS_TIMESTEP) + 1
+                 : HEADLESS_DEFAULT_FRAMES;
+
+  HeadlessTarget target = {0};
+  Scene scene;
+  if (!CreateTarget(&target, width, height) ||
+      !Scene_Init(&scene, options->seed, NULL)) {
+    FreeTarget(&target);
+    CameraPath_Free(&path);
+    DestroyContext(&ctx);
+    return 1;
+  }
+  const char *renderer = (const char *)glGetString(GL_RENDERER);
+  printf("Headless: %s, %dx%d, %d frames, seed %d\n", renderer, width, height,
+         frames, GetWorldSeed());
+
+  double *frameMs = (double *)malloc(frames * sizeof(double));
+  double *updateMs = (double *)malloc(frames * sizeof(double));
+  double *renderMs = (double *)malloc(frames * sizeof(double));
+  double *submitMs = (double *)malloc(frames * sizeof(double));
+  uint8_t *pixels = options->dumpDirectory
+                        ? (uint8_t *)malloc((size_t)width * height * 4)
+                        : NULL;
+  if (!frameMs || !updateMs || !renderMs || !submitMs ||
+      (options->dumpDirectory && !pixels)) {
+    printf("Headless: out of memory\n");
+    frames = 0;
+  }
+
+  // The initial load is already done; only count what streams in during the
+  // run.
+  long generatedStart = scene.chunkWorkers.generatedChunks;
+  long meshedStart = scene.chunkWorkers.meshedChunks;
+  vec3 start = scene.player.position;
+  long drawnChunks = 0, drawnTriangles = 0;
+  double toMs = 1000.0 / SDL_GetPerformanceFrequency();
+  Uint64 runStart = SDL_GetPerformanceCounter();
+
+  for (int i = 0; i < frames; i++) {
+    if (path.count > 0)
+      CameraPath_Apply(&path, i * HEADLESS_TIMESTEP, &scene.player);
+    else
+      MoveScriptedCamera(&scene.player, start, i * HEADLESS_TIMESTEP);
+
+    PROFILE_BEGIN("Frame");
+    Uint64 frameStart = SDL_GetPerformanceCounter();
+    Scene_Update(&scene, HEADLESS_TIMESTEP);
+    Uint64 renderStart = SDL_GetPerformanceCounter();
+    Scene_Render(&scene, width, height);
+    // Without a swap nothing bounds how far the driver runs ahead, so wait
+    // for the frame to finish to charge its GPU time to it.
+    PROFILE_BEGIN("Finish");
+    glFinish();
+    PROFILE_END();
+    Uint64 frameEnd = SDL_GetPerformanceCounter();
+    PROFILE_END();
+    PROFILE_FRAME_END();
+
+    frameMs[i] = (frameEnd - frameStart) * toMs;
+    updateMs[i] = (renderStart - frameStart) * toMs;
+    renderMs[i] = (frameEnd - renderStart) * toMs;
+    submitMs[i] = scene.drawSubmitMs;
+    drawnChunks += scene.drawStats.drawnChunks;
+    drawnTriangles += scene.drawStats.drawnTriangles;
+
+    if (pixels && i % options->dumpEvery == 0)
+      DumpFrame(options->dumpDirectory, i, width, height, pixels);
+  }
+
+  bool ok = frames > 0;
+  if (ok) {
+    BenchmarkReport report = {
+        .renderer = renderer,
+        .path = options->pathFile,
+        .seed = GetWorldSeed(),
+        .width = width,
+        .height = height,
+        .frames = frames,
+        .timestep = HEADLESS_TIMESTEP,
+        .seconds = (SDL_GetPerformanceCounter() - runStart) * toMs / 1000.0,
+        .frameMs = Benchmark_Summarize(frameMs, frames),
+        .updateMs = Benchmark_Summarize(updateMs, frames),
+        .renderMs = Benchmark_Summarize(renderMs, frames),
+        .submitMs = Benchmark_Summarize(submitMs, frames),
+        .chunksGenerated = scene.chunkWorkers.generatedChunks - generatedStart,
+        .chunksMeshed = scene.chunkWorkers.meshedChunks - meshedStart,
+        .trianglesSubmitted = drawnTriangles,
+        .peakResidentBytes = Benchmark_PeakResidentBytes(),
+        .arenaBytes = (long)GetChunkMeshArenaStats().capacity};
+    for (int i = 0; i < MEM_TAG_COUNT; i++)
+      report.memory[i] = Memory_Stats((MemoryTag)i);
+
+    printf("Headless: %d frames in %.2f s\n", frames, report.seconds);
+    PrintTiming("frame", report.frameMs);
+    PrintTiming("update", report.updateMs);
+    PrintTiming("render", report.renderMs);
+    PrintTiming("submit", report.submitMs);
+    printf("  drawn   %.1f chunks, %.0f triangles per frame\n",
+           (double)drawnChunks / frames, (double)drawnTriangles / frames);
+    printf("  chunks  %.1f generated/s, %.1f meshed/s\n",
+           report.chunksGenerated / report.seconds,
+           report.chunksMeshed / report.seconds);
+    printf("  memory  %.1f MiB peak resident, %.1f MiB chunk arena\n",
+           report.peakResidentBytes / 1048576.0,
+           report.arenaBytes / 1048576.0);
+    for (int i = 0; i < MEM_TAG_COUNT; i++)
+      printf("  %-12s %8.2f MiB live, %8.2f MiB peak\n",
+             Memory_TagName((MemoryTag)i), report.memory[i].live / 1048576.0,
+             report.memory[i].peak / 1048576.0);
+#if PROFILER_ENABLED
+    const char *labels[3] = {"cpu", "workers", "gpu"};
+    char scopes[512];
+    for (int i = 0; i < 3; i++) {
+      Profiler_FormatOverlay((ProfilerTrack)i, scopes, sizeof(scopes));
+      printf("  %-7s %s\n", labels[i], scopes);
+    }
+#endif
+
+    if (options->reportFile)
+      ok = Benchmark_WriteReport(&report, options->reportFile);
+  }
+
+  free(frameMs);
+  free(updateMs);
+  free(renderMs);
+  free(submitMs);
+  free(pixels);
+  CameraPath_Free(&path);
+
+  Scene_Free(&scene);
+#if PROFILER_ENABLED
+  if (options->traceFile && !Profiler_WriteTrace(options->traceFile))
+    ok = false;
+  Profiler_Shutdown();
+#endif
+  FreeTarget(&target);
+  DestroyContext(&ctx);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,28 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <stdbool.h>
+
+// Renders into an offscreen framebuffer on a surfaceless EGL context, so the
+// engine can be benchmarked on machines without a display (Mesa llvmpipe).
+// A frames count of 0 runs the whole camera path, or a default length
+// without one. The --verify-* checks need no display or GL context at all.
+typedef struct {
+  int frames;
+  int width;
+  int height;
+  int seed; // nonzero, so every run of a seed renders the same world
+  const char *pathFile;      // NULL for the built-in flight
+  const char *reportFile;    // NULL to only print the timings
+  const char *traceFile;     // Chrome trace written at exit, NULL for none
+  const char *dumpDirectory; // NULL to skip writing PNGs
+  int dumpEvery;
+  bool verifyChunks;  // run the chunk checksum check instead of rendering
+  bool verifyMeshers; // run the mesher count check instead of rendering
+  const char *bench;  // microbenchmark to run instead of rendering, or NULL
+} HeadlessOptions;
+
+bool Headless_ParseArgs(int argc, char **argv, HeadlessOptions *options);
+int Headless_Run(const HeadlessOptions *options);
+
+#endif
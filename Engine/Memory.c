@@ -0,0 +1,120 @@
+#include "Memory.h"
+#include <malloc.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct {
+    MemoryGLKind kind;
+    unsigned int name;
+    MemoryTag tag;
+    size_t bytes;
+} MemoryGLObject;
+
+static const char* const g_tagNames[MEM_TAG_COUNT] = {
+    "Voxel", "Mesh scratch", "GPU vertex", "GPU texture", "UI", "Shader"};
+
+static atomic_size_t g_live[MEM_TAG_COUNT];
+static atomic_size_t g_peak[MEM_TAG_COUNT];
+
+static MemoryGLObject* g_glObjects;
+static int g_glCount;
+static int g_glCapacity;
+
+static void AddBytes(MemoryTag tag, size_t bytes) {
+    size_t live = atomic_fetch_add_explicit(&g_live[tag], bytes, memory_order_relaxed) + bytes;
+    size_t peak = atomic_load_explicit(&g_peak[tag], memory_order_relaxed);
+    while (live > peak &&
+           !atomic_compare_exchange_weak_explicit(&g_peak[tag], &peak, live, memory_order_relaxed,
+                                                  memory_order_relaxed)) {}
+}
+
+static void SubtractBytes(MemoryTag tag, size_t bytes) {
+    atomic_fetch_sub_explicit(&g_live[tag], bytes, memory_order_relaxed);
+}
+
+// Blocks are counted at their usable size, which is what they really cost
+// and needs no header, so a tracked block is still an ordinary heap block.
+void* Memory_Alloc(MemoryTag tag, size_t size) {
+    void* p = malloc(size);
+    if (p) AddBytes(tag, malloc_usable_size(p));
+    return p;
+}
+
+void* Memory_Calloc(MemoryTag tag, size_t count, size_t size) {
+    void* p = calloc(count, size);
+    if (p) AddBytes(tag, malloc_usable_size(p));
+    return p;
+}
+
+void* Memory_Realloc(MemoryTag tag, void* p, size_t size) {
+    size_t old = p ? malloc_usable_size(p) : 0;
+    void* grown = realloc(p, size);
+    if (!grown) return NULL;
+    SubtractBytes(tag, old);
+    AddBytes(tag, malloc_usable_size(grown));
+    return grown;
+}
+
+void Memory_Free(MemoryTag tag, void* p) {
+    if (!p) return;
+    SubtractBytes(tag, malloc_usable_size(p));
+    free(p);
+}
+
+static int FindGL(MemoryGLKind kind, unsigned int name) {
+    for (int i = 0; i < g_glCount; i++)
+        if (g_glObjects[i].kind == kind && g_glObjects[i].name == name) return i;
+    return -1;
+}
+
+// Respecifying an object replaces its old size.
+void Memory_TrackGL(MemoryGLKind kind, unsigned int name, MemoryTag tag, size_t bytes) {
+    int i = FindGL(kind, name);
+    if (i >= 0) {
+        SubtractBytes(g_glObjects[i].tag, g_glObjects[i].bytes);
+        g_glObjects[i].tag = tag;
+        g_glObjects[i].bytes = bytes;
+        AddBytes(tag, bytes);
+        return;
+    }
+
+    if (g_glCount == g_glCapacity) {
+        int capacity = g_glCapacity ? g_glCapacity * 2 : 32;
+        MemoryGLObject* grown = (MemoryGLObject*)realloc(g_glObjects, capacity * sizeof(MemoryGLObject));
+        if (!grown) return;
+        g_glObjects = grown;
+        g_glCapacity = capacity;
+    }
+    g_glObjects[g_glCount++] = (MemoryGLObject){kind, name, tag, bytes};
+    AddBytes(tag, bytes);
+}
+
+void Memory_UntrackGL(MemoryGLKind kind, unsigned int name) {
+    int i = FindGL(kind, name);
+    if (i < 0) return;
+    SubtractBytes(g_glObjects[i].tag, g_glObjects[i].bytes);
+    g_glObjects[i] = g_glObjects[--g_glCount];
+}
+
+MemoryTagStats Memory_Stats(MemoryTag tag) {
+    return (MemoryTagStats){atomic_load_explicit(&g_live[tag], memory_order_relaxed),
+                            atomic_load_explicit(&g_peak[tag], memory_order_relaxed)};
+}
+
+const char* Memory_TagName(MemoryTag tag) {
+    return g_tagNames[tag];
+}
+
+// "name live/peak" in MiB for every tag.
+void Memory_FormatOverlay(char* out, size_t size) {
+    size_t used = 0;
+    out[0] = '\0';
+    for (int i = 0; i < MEM_TAG_COUNT && used < size; i++) {
+        MemoryTagStats stats = Memory_Stats((MemoryTag)i);
+        int n = snprintf(out + used, size - used, "%s%s %.1f/%.1f", used ? "  " : "", g_tagNames[i],
+                         stats.live / 1048576.0, stats.peak / 1048576.0);
+        if (n < 0) break;
+        used += (size_t)n;
+    }
+}
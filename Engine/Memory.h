@@ -0,0 +1,49 @@
+#ifndef MEMORY_H
+#define MEMORY_H
+#include <stdbool.h>
+#include <stddef.h>
+
+// What an allocation is for. CPU tags count heap bytes; GPU tags count the
+// bytes GL objects were sized with. UI and Shader count whatever those
+// systems own, on either side.
+typedef enum {
+    MEM_TAG_VOXEL,
+    MEM_TAG_MESH_SCRATCH,
+    MEM_TAG_GPU_VERTEX,
+    MEM_TAG_GPU_TEXTURE,
+    MEM_TAG_UI,
+    MEM_TAG_SHADER,
+    MEM_TAG_COUNT
+} MemoryTag;
+
+// GL names are only unique within one kind of object. Names are taken as
+// unsigned int so CPU-only code can use this header without GL.
+typedef enum {
+    MEM_GL_BUFFER,
+    MEM_GL_TEXTURE,
+    MEM_GL_RENDERBUFFER
+} MemoryGLKind;
+
+typedef struct {
+    size_t live;
+    size_t peak;
+} MemoryTagStats;
+
+// Drop-in replacements for malloc and friends, safe from any thread. A
+// block must be freed or reallocated under the tag it was allocated with.
+void* Memory_Alloc(MemoryTag tag, size_t size);
+void* Memory_Calloc(MemoryTag tag, size_t count, size_t size);
+void* Memory_Realloc(MemoryTag tag, void* p, size_t size);
+void Memory_Free(MemoryTag tag, void* p);
+
+// Call after each glBufferData, glBufferStorage, glTexImage2D or
+// glRenderbufferStorage with the object's new size, and before deleting it.
+// Main thread only, like the GL calls themselves.
+void Memory_TrackGL(MemoryGLKind kind, unsigned int name, MemoryTag tag, size_t bytes);
+void Memory_UntrackGL(MemoryGLKind kind, unsigned int name);
+
+MemoryTagStats Memory_Stats(MemoryTag tag);
+const char* Memory_TagName(MemoryTag tag);
+void Memory_FormatOverlay(char* out, size_t size);
+
+#endif
@@ -0,0 +1,240 @@
+#include "MeshArena.h"
+#include "Memory.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MESH_ARENA_WAIT_NS 1000000000ull
+
+// Buffer allocation failures are only reported through glGetError, so clear
+// anything already pending before checking.
+static void ClearGLErrors(void) {
+    while (glGetError() != GL_NO_ERROR) {}
+}
+
+static size_t AlignSize(size_t size) {
+    return (size + MESH_ARENA_ALIGN - 1) & ~(size_t)(MESH_ARENA_ALIGN - 1);
+}
+
+static bool InsertFreeBlock(MeshArena* a, int at, MeshArenaBlock block) {
+    if (a->freeCount == a->freeCapacity) {
+        int capacity = a->freeCapacity ? a->freeCapacity * 2 : 64;
+        MeshArenaBlock* grown = (MeshArenaBlock*)realloc(a->freeBlocks, capacity * sizeof(MeshArenaBlock));
+        if (!grown) return false;
+        a->freeBlocks = grown;
+        a->freeCapacity = capacity;
+    }
+    memmove(a->freeBlocks + at + 1, a->freeBlocks + at, (a->freeCount - at) * sizeof(MeshArenaBlock));
+    a->freeBlocks[at] = block;
+    a->freeCount++;
+    return true;
+}
+
+static void RemoveFreeBlock(MeshArena* a, int at) {
+    memmove(a->freeBlocks + at, a->freeBlocks + at + 1, (a->freeCount - at - 1) * sizeof(MeshArenaBlock));
+    a->freeCount--;
+}
+
+// Returns the block back to the free list, merging it with free neighbours.
+static void AddFreeRange(MeshArena* a, size_t offset, size_t size) {
+    int lo = 0, hi = a->freeCount;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (a->freeBlocks[mid].offset < offset) lo = mid + 1;
+        else hi = mid;
+    }
+
+    bool joinPrev = lo > 0 && a->freeBlocks[lo - 1].offset + a->freeBlocks[lo - 1].size == offset;
+    bool joinNext = lo < a->freeCount && offset + size == a->freeBlocks[lo].offset;
+    if (joinPrev && joinNext) {
+        a->freeBlocks[lo - 1].size += size + a->freeBlocks[lo].size;
+        RemoveFreeBlock(a, lo);
+    } else if (joinPrev) {
+        a->freeBlocks[lo - 1].size += size;
+    } else if (joinNext) {
+        a->freeBlocks[lo].offset = offset;
+        a->freeBlocks[lo].size += size;
+    } else if (!InsertFreeBlock(a, lo, (MeshArenaBlock){offset, size})) {
+        // Out of memory for the list: the range simply stays unusable.
+        printf("MeshArena: lost %zu bytes, free list is full\n", size);
+    }
+}
+
+bool MeshArena_Init(MeshArena* a, size_t capacity, size_t stagingSize) {
+    *a = (MeshArena){0};
+    a->capacity = AlignSize(capacity);
+
+    ClearGLErrors();
+    glGenBuffers(1, &a->buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, a->buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, a->capacity, NULL, GL_STATIC_DRAW);
+    if (glGetError() != GL_NO_ERROR) {
+        printf("MeshArena: could not allocate %zu bytes\n", a->capacity);
+        glDeleteBuffers(1, &a->buffer);
+        *a = (MeshArena){0};
+        return false;
+    }
+    Memory_TrackGL(MEM_GL_BUFFER, a->buffer, MEM_TAG_GPU_VERTEX, a->capacity);
+    AddFreeRange(a, 0, a->capacity);
+
+    if (stagingSize && GLEW_ARB_buffer_storage) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glGenBuffers(1, &a->staging);
+        glBindBuffer(GL_COPY_READ_BUFFER, a->staging);
+        glBufferStorage(GL_COPY_READ_BUFFER, stagingSize, NULL, flags);
+        a->stagingMap = (uint8_t*)glMapBufferRange(GL_COPY_READ_BUFFER, 0, stagingSize, flags);
+        if (a->stagingMap) {
+            a->stagingSize = stagingSize;
+            Memory_TrackGL(MEM_GL_BUFFER, a->staging, MEM_TAG_GPU_VERTEX, stagingSize);
+        } else {
+            glDeleteBuffers(1, &a->staging);
+            a->staging = 0;
+        }
+    }
+    if (!a->stagingMap)
+        printf("MeshArena: no persistent staging, uploading with glBufferSubData\n");
+    return true;
+}
+
+void MeshArena_Destroy(MeshArena* a) {
+    for (int i = 0; i < a->fenceCount; i++)
+        glDeleteSync(a->fences[(a->fenceFirst + i) % MESH_ARENA_FENCES].sync);
+    if (a->staging) {
+        glBindBuffer(GL_COPY_READ_BUFFER, a->staging);
+        glUnmapBuffer(GL_COPY_READ_BUFFER);
+        Memory_UntrackGL(MEM_GL_BUFFER, a->staging);
+        glDeleteBuffers(1, &a->staging);
+    }
+    if (a->buffer) {
+        Memory_UntrackGL(MEM_GL_BUFFER, a->buffer);
+        glDeleteBuffers(1, &a->buffer);
+    }
+    free(a->freeBlocks);
+    *a = (MeshArena){0};
+}
+
+bool MeshArena_Alloc(MeshArena* a, size_t size, size_t* offset) {
+    size = AlignSize(size);
+    int best = -1;
+    for (int i = 0; i < a->freeCount; i++) {
+        if (a->freeBlocks[i].size < size) continue;
+        if (best < 0 || a->freeBlocks[i].size < a->freeBlocks[best].size) best = i;
+        if (a->freeBlocks[i].size == size) break;
+    }
+    if (best < 0) return false;
+
+    MeshArenaBlock* block = &a->freeBlocks[best];
+    *offset = block->offset;
+    block->offset += size;
+    block->size -= size;
+    if (block->size == 0) RemoveFreeBlock(a, best);
+    a->used += size;
+    return true;
+}
+
+// size is what was passed to MeshArena_Alloc.
+void MeshArena_Release(MeshArena* a, size_t offset, size_t size) {
+    size = AlignSize(size);
+    a->used -= size;
+    AddFreeRange(a, offset, size);
+}
+
+// Doubles the buffer, copying the live contents on the GPU. Offsets stay
+// valid but the buffer name changes, so anything bound to it must be rebound.
+bool MeshArena_Grow(MeshArena* a) {
+    size_t capacity = a->capacity * 2;
+    GLuint buffer;
+    ClearGLErrors();
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, capacity, NULL, GL_STATIC_DRAW);
+    if (glGetError() != GL_NO_ERROR) {
+        printf("MeshArena: could not grow to %zu bytes\n", capacity);
+        glDeleteBuffers(1, &buffer);
+        return false;
+    }
+
+    glBindBuffer(GL_COPY_READ_BUFFER, a->buffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, a->capacity);
+    Memory_UntrackGL(MEM_GL_BUFFER, a->buffer);
+    glDeleteBuffers(1, &a->buffer);
+    a->buffer = buffer;
+    Memory_TrackGL(MEM_GL_BUFFER, buffer, MEM_TAG_GPU_VERTEX, capacity);
+    AddFreeRange(a, a->capacity, capacity - a->capacity);
+    a->capacity = capacity;
+    return true;
+}
+
+// Retires the oldest fence, waiting for it if wait is set.
+static bool RetireFence(MeshArena* a, bool wait) {
+    MeshArenaFence* f = &a->fences[a->fenceFirst];
+    GLenum status;
+    do {
+        status = glClientWaitSync(f->sync, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? MESH_ARENA_WAIT_NS : 0);
+    } while (wait && status == GL_TIMEOUT_EXPIRED);
+    if (status == GL_TIMEOUT_EXPIRED) return false;
+
+    glDeleteSync(f->sync);
+    a->stagingTail = f->end;
+    a->fenceFirst = (a->fenceFirst + 1) % MESH_ARENA_FENCES;
+    a->fenceCount--;
+    return true;
+}
+
+// Fences everything staged so far. Call once per frame; retiring is
+// non-blocking here unless every fence slot is taken.
+void MeshArena_Fence(MeshArena* a) {
+    if (!a->stagingMap) return;
+    while (a->fenceCount > 0 && RetireFence(a, false)) {}
+    if (a->stagingHead == a->fencedHead) return;
+
+    if (a->fenceCount == MESH_ARENA_FENCES) RetireFence(a, true);
+    int slot = (a->fenceFirst + a->fenceCount) % MESH_ARENA_FENCES;
+    a->fences[slot] = (MeshArenaFence){glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), a->stagingHead};
+    a->fenceCount++;
+    a->fencedHead = a->stagingHead;
+}
+
+// Finds size contiguous bytes in the ring, waiting on the GPU when it is
+// full. Uploads are at most half the ring, so skipping to the start after a
+// wrap always leaves room once the ring drains.
+static size_t ReserveStaging(MeshArena* a, size_t size) {
+    for (;;) {
+        if (a->stagingHead == a->stagingTail && a->fenceCount == 0)
+            a->stagingHead = a->stagingTail = a->fencedHead = 0;
+
+        size_t at = (size_t)(a->stagingHead % a->stagingSize);
+        size_t pad = at + size > a->stagingSize ? a->stagingSize - at : 0;
+        if (a->stagingHead - a->stagingTail + pad + size <= a->stagingSize) {
+            a->stagingHead += pad + size;
+            return pad ? 0 : at;
+        }
+
+        if (a->fenceCount == 0) MeshArena_Fence(a);
+        if (a->fenceCount > 0) RetireFence(a, true);
+    }
+}
+
+void MeshArena_Upload(MeshArena* a, size_t offset, const void* data, size_t size) {
+    if (size == 0) return;
+    glBindBuffer(GL_COPY_WRITE_BUFFER, a->buffer);
+    if (!a->stagingMap || size > a->stagingSize / 2) {
+        glBufferSubData(GL_COPY_WRITE_BUFFER, offset, size, data);
+        return;
+    }
+
+    size_t at = ReserveStaging(a, size);
+    memcpy(a->stagingMap + at, data, size);
+    glBindBuffer(GL_COPY_READ_BUFFER, a->staging);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, at, offset, size);
+}
+
+MeshArenaStats MeshArena_Stats(const MeshArena* a) {
+    MeshArenaStats stats = {a->capacity, a->used, 0, a->freeCount, 0.0f, a->stagingMap != NULL};
+    for (int i = 0; i < a->freeCount; i++)
+        if (a->freeBlocks[i].size > stats.largestFree) stats.largestFree = a->freeBlocks[i].size;
+
+    size_t freeBytes = a->capacity - a->used;
+    if (freeBytes > 0) stats.fragmentation = 1.0f - (float)stats.largestFree / (float)freeBytes;
+    return stats;
+}
@@ -0,0 +1,68 @@
+#ifndef MESHARENA_H
+#define MESHARENA_H
+#include <GL/glew.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Blocks are handed out in multiples of this many bytes, which keeps the
+// free list short and every offset a whole number of vertices.
+#define MESH_ARENA_ALIGN 256
+#define MESH_ARENA_FENCES 16
+
+typedef struct {
+    size_t offset;
+    size_t size;
+} MeshArenaBlock;
+
+// Staging bytes before end (a running byte count) are free once sync signals.
+typedef struct {
+    GLsync sync;
+    uint64_t end;
+} MeshArenaFence;
+
+// One GL buffer shared by many meshes, sub-allocated from a best-fit free
+// list that is kept sorted by offset and coalesced on release. When the
+// driver has ARB_buffer_storage, uploads are copied into a persistently
+// mapped staging ring and then into place on the GPU; fences mark how much
+// of the ring the GPU has consumed. Without it, uploads go straight through
+// glBufferSubData.
+typedef struct {
+    GLuint buffer;
+    size_t capacity;
+    size_t used;
+    MeshArenaBlock* freeBlocks;
+    int freeCount;
+    int freeCapacity;
+
+    GLuint staging;
+    uint8_t* stagingMap;
+    size_t stagingSize;
+    uint64_t stagingHead;
+    uint64_t stagingTail;
+    uint64_t fencedHead;
+    MeshArenaFence fences[MESH_ARENA_FENCES];
+    int fenceFirst;
+    int fenceCount;
+} MeshArena;
+
+// Fragmentation is the share of free bytes outside the largest free block.
+typedef struct {
+    size_t capacity;
+    size_t used;
+    size_t largestFree;
+    int freeBlocks;
+    float fragmentation;
+    bool staged;
+} MeshArenaStats;
+
+bool MeshArena_Init(MeshArena* arena, size_t capacity, size_t stagingSize);
+void MeshArena_Destroy(MeshArena* arena);
+bool MeshArena_Alloc(MeshArena* arena, size_t size, size_t* offset);
+void MeshArena_Release(MeshArena* arena, size_t offset, size_t size);
+bool MeshArena_Grow(MeshArena* arena);
+void MeshArena_Upload(MeshArena* arena, size_t offset, const void* data, size_t size);
+void MeshArena_Fence(MeshArena* arena);
+MeshArenaStats MeshArena_Stats(const MeshArena* arena);
+
+#endif
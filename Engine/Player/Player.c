@@ -23,32 +23,12 @@ void InitPlayer(Player* player, vec3 startPos) {
     InitCamera(&player->cam, camPos);
 }
 
-bool IsBlockSolid(Chunk** chunks, int chunkCount, vec3 worldPos, int chunkSize, float voxelSize) {
-    for (int i = 0; i < chunkCount; i++) {
-        Chunk* c = chunks[i];
-        if (!c) continue;
-
-        float relX = worldPos.x - c->position.x;
-        float relY = worldPos.y - c->position.y;
-        float relZ = worldPos.z - c->position.z;
-
-        int bx = (int)(relX / voxelSize);
-        int by = (int)(relY / voxelSize);
-        int bz = (int)(relZ / voxelSize);
-
-        if (bx >= 0 && bx < chunkSize &&
-            by >= 0 && by < chunkSize &&
-            bz >= 0 && bz < chunkSize) {
-
-            Block* b = c->blocks[bx][by][bz];
-            if (b && b->active) return true;
-        }
-    }
-    return false;
+bool IsBlockSolid(const ChunkMap* map, vec3 worldPos, int chunkSize, float voxelSize) {
+    return GetWorldBlock(map, worldPos, chunkSize, voxelSize) != BLOCK_AIR;
 }
 
 bool CheckCollision(vec3 pos, float width, float height,
-                    Chunk** chunks, int chunkCount,
+                    const ChunkMap* map,
                     int chunkSize, float voxelSize)
 {
     float halfWidth = width * 0.5f;
@@ -65,7 +45,7 @@ bool CheckCollision(vec3 pos, float width, float height,
     };
 
     for (int i = 0; i < 8; i++) {
-        if (IsBlockSolid(chunks, chunkCount, checkPoints[i], chunkSize, voxelSize))
+        if (IsBlockSolid(map, checkPoints[i], chunkSize, voxelSize))
             return true;
     }
     return false;
@@ -114,7 +94,7 @@ void ProcessPlayerMouseMovement(Player* player, float xrel, float yrel) {
 }
 
 void UpdatePlayer(Player* player, float deltaTime,
-                  Chunk** chunks, int chunkCount,
+                  const ChunkMap* map,
                   int chunkSize, float voxelSize)
 {
     player->velocity.y += GRAVITY * deltaTime;
@@ -123,7 +103,7 @@ void UpdatePlayer(Player* player, float deltaTime,
 
     newPos.x += player->velocity.x * deltaTime;
     if (CheckCollision(newPos, player->width, player->height,
-                       chunks, chunkCount, chunkSize, voxelSize))
+                       map, chunkSize, voxelSize))
     {
         newPos.x = player->position.x;
         player->velocity.x = 0;
@@ -131,7 +111,7 @@ void UpdatePlayer(Player* player, float deltaTime,
 
     newPos.z += player->velocity.z * deltaTime;
     if (CheckCollision(newPos, player->width, player->height,
-                       chunks, chunkCount, chunkSize, voxelSize))
+                       map, chunkSize, voxelSize))
     {
         newPos.z = player->position.z;
         player->velocity.z = 0;
@@ -139,7 +119,7 @@ void UpdatePlayer(Player* player, float deltaTime,
 
     newPos.y += player->velocity.y * deltaTime;
     if (CheckCollision(newPos, player->width, player->height,
-                       chunks, chunkCount, chunkSize, voxelSize))
+                       map, chunkSize, voxelSize))
     {
         if (player->velocity.y < 0)
             player->onGround = true;
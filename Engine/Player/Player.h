@@ -20,10 +20,10 @@ typedef struct {
 } Player;
 
 void InitPlayer(Player* player, vec3 startPos);
-void UpdatePlayer(Player* player, float deltaTime, Chunk** chunks, int chunkCount, int chunkSize, float voxelSize);
+void UpdatePlayer(Player* player, float deltaTime, const ChunkMap* map, int chunkSize, float voxelSize);
 void ProcessPlayerInput(Player* player, float deltaTime);
 void ProcessPlayerMouseMovement(Player* player, float xrel, float yrel);
-bool CheckCollision(vec3 pos, float width, float height, Chunk** chunks, int chunkCount, int chunkSize, float voxelSize);
+bool CheckCollision(vec3 pos, float width, float height, const ChunkMap* map, int chunkSize, float voxelSize);
 vec3 GetPlayerCameraPosition(Player* player);
 
 #endif
@@ -0,0 +1,306 @@
+#include "Profiler.h"
+
+#if PROFILER_ENABLED
+#include <GL/glew.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Weight of the newest frame in the rolling averages.
+#define PROFILER_SMOOTHING 0.05
+
+typedef struct {
+    const char* name;
+    uint64_t start;
+    uint64_t duration;
+} ProfilerEvent;
+
+// Only the owning thread writes events or touches the open scope stack; the
+// lock is there for the main thread reading the ring, so it is uncontended
+// almost always.
+typedef struct {
+    pthread_mutex_t lock;
+    ProfilerEvent events[PROFILER_RING_SIZE];
+    uint64_t head;
+    uint64_t scanned;
+    const char* openNames[PROFILER_MAX_DEPTH];
+    uint64_t openStarts[PROFILER_MAX_DEPTH];
+    int depth;
+    int id;
+    char name[32];
+} ProfilerThread;
+
+typedef struct {
+    const char* name;
+    ProfilerTrack track;
+    double frameMs;
+    double averageMs;
+} ProfilerScope;
+
+typedef struct {
+    GLuint queries[PROFILER_GPU_PASSES];
+    const char* names[PROFILER_GPU_PASSES];
+    uint64_t starts[PROFILER_GPU_PASSES];
+    int count;
+} ProfilerGpuFrame;
+
+static pthread_mutex_t g_profilerLock = PTHREAD_MUTEX_INITIALIZER;
+static ProfilerThread* g_threads[PROFILER_MAX_THREADS];
+static int g_threadCount;
+static uint64_t g_epoch;
+static _Thread_local ProfilerThread* t_thread;
+static _Thread_local bool t_unregistered;
+
+// Main thread only from here on.
+static ProfilerScope g_scopes[PROFILER_MAX_SCOPES];
+static int g_scopeCount;
+
+static ProfilerThread* g_gpuThread;
+static ProfilerGpuFrame g_gpuFrames[PROFILER_GPU_FRAMES];
+static int g_gpuFrame;
+static int g_gpuDepth;
+static bool g_gpuReady;
+static bool g_gpuRecording;
+
+static uint64_t ProfilerNow(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static ProfilerThread* RegisterThread(const char* name) {
+    ProfilerThread* th = (ProfilerThread*)calloc(1, sizeof(ProfilerThread));
+    if (!th) return NULL;
+    pthread_mutex_init(&th->lock, NULL);
+
+    pthread_mutex_lock(&g_profilerLock);
+    if (g_threadCount == PROFILER_MAX_THREADS) {
+        pthread_mutex_unlock(&g_profilerLock);
+        pthread_mutex_destroy(&th->lock);
+        free(th);
+        return NULL;
+    }
+    if (g_threadCount == 0) g_epoch = ProfilerNow();
+    th->id = g_threadCount + 1;
+    if (name) snprintf(th->name, sizeof(th->name), "%s", name);
+    else snprintf(th->name, sizeof(th->name), "Thread %d", th->id);
+    g_threads[g_threadCount++] = th;
+    pthread_mutex_unlock(&g_profilerLock);
+    return th;
+}
+
+static ProfilerThread* CurrentThread(void) {
+    if (!t_thread && !t_unregistered) {
+        t_thread = RegisterThread(NULL);
+        t_unregistered = !t_thread;
+    }
+    return t_thread;
+}
+
+static void PushEvent(ProfilerThread* th, ProfilerEvent event) {
+    pthread_mutex_lock(&th->lock);
+    th->events[th->head % PROFILER_RING_SIZE] = event;
+    th->head++;
+    pthread_mutex_unlock(&th->lock);
+}
+
+int Profiler_Begin(const char* name) {
+    ProfilerThread* th = CurrentThread();
+    if (!th) return 0;
+    // Scopes past the depth limit still count, so the stack stays balanced,
+    // but aren't recorded.
+    if (th->depth < PROFILER_MAX_DEPTH) {
+        th->openNames[th->depth] = name;
+        th->openStarts[th->depth] = ProfilerNow();
+    }
+    th->depth++;
+    return 0;
+}
+
+void Profiler_End(void) {
+    ProfilerThread* th = t_thread;
+    if (!th || th->depth == 0) return;
+    th->depth--;
+    if (th->depth < PROFILER_MAX_DEPTH) {
+        uint64_t start = th->openStarts[th->depth];
+        PushEvent(th, (ProfilerEvent){th->openNames[th->depth], start, ProfilerNow() - start});
+    }
+}
+
+void Profiler_EndScope(int* scope) {
+    (void)scope;
+    Profiler_End();
+}
+
+void Profiler_SetThreadName(const char* name) {
+    ProfilerThread* th = CurrentThread();
+    if (!th) return;
+    pthread_mutex_lock(&th->lock);
+    snprintf(th->name, sizeof(th->name), "%s", name);
+    pthread_mutex_unlock(&th->lock);
+}
+
+// GL_TIME_ELAPSED queries are core since 3.3. Each frame gets its own set so
+// results are read back PROFILER_GPU_FRAMES frames later, when they are
+// normally available without a stall.
+void Profiler_GpuBegin(const char* name) {
+    if (g_gpuDepth++ > 0) return;
+    if (!g_gpuReady) {
+        g_gpuThread = RegisterThread("GPU");
+        if (!g_gpuThread) return;
+        for (int i = 0; i < PROFILER_GPU_FRAMES; i++)
+            glGenQueries(PROFILER_GPU_PASSES, g_gpuFrames[i].queries);
+        g_gpuReady = true;
+    }
+
+    ProfilerGpuFrame* frame = &g_gpuFrames[g_gpuFrame];
+    if (frame->count == PROFILER_GPU_PASSES) return;
+    frame->names[frame->count] = name;
+    frame->starts[frame->count] = ProfilerNow();
+    glBeginQuery(GL_TIME_ELAPSED, frame->queries[frame->count]);
+    g_gpuRecording = true;
+}
+
+void Profiler_GpuEnd(void) {
+    if (g_gpuDepth == 0 || --g_gpuDepth > 0 || !g_gpuRecording) return;
+    glEndQuery(GL_TIME_ELAPSED);
+    g_gpuFrames[g_gpuFrame].count++;
+    g_gpuRecording = false;
+}
+
+// GPU passes are placed in the trace at the CPU time they were submitted;
+// only their durations are measured.
+static void ReadGpuFrame(ProfilerGpuFrame* frame) {
+    for (int i = 0; i < frame->count; i++) {
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(frame->queries[i], GL_QUERY_RESULT, &elapsed);
+        PushEvent(g_gpuThread, (ProfilerEvent){frame->names[i], frame->starts[i], elapsed});
+    }
+    frame->count = 0;
+}
+
+static void AddToScope(const char* name, ProfilerTrack track, double ms) {
+    for (int i = 0; i < g_scopeCount; i++) {
+        if (g_scopes[i].track == track && strcmp(g_scopes[i].name, name) == 0) {
+            g_scopes[i].frameMs += ms;
+            return;
+        }
+    }
+    if (g_scopeCount < PROFILER_MAX_SCOPES)
+        g_scopes[g_scopeCount++] = (ProfilerScope){name, track, ms, ms};
+}
+
+// Call once per frame from the thread that renders. Scopes from other
+// threads are summed into the frame they finished in.
+void Profiler_EndFrame(void) {
+    ProfilerThread* self = CurrentThread();
+    if (g_gpuReady) {
+        g_gpuFrame = (g_gpuFrame + 1) % PROFILER_GPU_FRAMES;
+        ReadGpuFrame(&g_gpuFrames[g_gpuFrame]);
+    }
+
+    pthread_mutex_lock(&g_profilerLock);
+    int threadCount = g_threadCount;
+    pthread_mutex_unlock(&g_profilerLock);
+
+    for (int t = 0; t < threadCount; t++) {
+        ProfilerThread* th = g_threads[t];
+        ProfilerTrack track = th == g_gpuThread ? PROFILER_TRACK_GPU
+                            : th == self        ? PROFILER_TRACK_MAIN
+                                                : PROFILER_TRACK_WORKERS;
+        pthread_mutex_lock(&th->lock);
+        uint64_t first = th->head > PROFILER_RING_SIZE ? th->head - PROFILER_RING_SIZE : 0;
+        if (th->scanned > first) first = th->scanned;
+        for (uint64_t i = first; i < th->head; i++) {
+            const ProfilerEvent* e = &th->events[i % PROFILER_RING_SIZE];
+            AddToScope(e->name, track, e->duration / 1e6);
+        }
+        th->scanned = th->head;
+        pthread_mutex_unlock(&th->lock);
+    }
+
+    for (int i = 0; i < g_scopeCount; i++) {
+        g_scopes[i].averageMs += (g_scopes[i].frameMs - g_scopes[i].averageMs) * PROFILER_SMOOTHING;
+        g_scopes[i].frameMs = 0.0;
+    }
+}
+
+// "name ms" for every scope on the track, in the order they first appeared.
+void Profiler_FormatOverlay(ProfilerTrack track, char* out, size_t size) {
+    size_t used = 0;
+    out[0] = '\0';
+    for (int i = 0; i < g_scopeCount && used < size; i++) {
+        if (g_scopes[i].track != track) continue;
+        int n = snprintf(out + used, size - used, "%s%s %.2f", used ? "  " : "",
+                         g_scopes[i].name, g_scopes[i].averageMs);
+        if (n < 0) break;
+        used += (size_t)n;
+    }
+}
+
+// Writes the events still in every ring as Chrome trace_event JSON, which
+// chrome://tracing and Perfetto open directly. Scope names are written
+// verbatim, so they must not need escaping.
+bool Profiler_WriteTrace(const char* file) {
+    FILE* f = fopen(file, "w");
+    if (!f) {
+        printf("Profiler: could not write %s\n", file);
+        return false;
+    }
+
+    pthread_mutex_lock(&g_profilerLock);
+    int threadCount = g_threadCount;
+    pthread_mutex_unlock(&g_profilerLock);
+
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", f);
+    bool first = true;
+    for (int t = 0; t < threadCount; t++) {
+        ProfilerThread* th = g_threads[t];
+        pthread_mutex_lock(&th->lock);
+        fprintf(f, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                first ? "" : ",", th->id, th->name);
+        first = false;
+        uint64_t begin = th->head > PROFILER_RING_SIZE ? th->head - PROFILER_RING_SIZE : 0;
+        for (uint64_t i = begin; i < th->head; i++) {
+            const ProfilerEvent* e = &th->events[i % PROFILER_RING_SIZE];
+            fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                    e->name, th->id, (e->start - g_epoch) / 1000.0, e->duration / 1000.0);
+        }
+        pthread_mutex_unlock(&th->lock);
+    }
+    fputs("\n]}\n", f);
+
+    bool ok = !ferror(f);
+    if (fclose(f) != 0) ok = false;
+    if (ok) printf("Profiler: wrote %s\n", file);
+    else printf("Profiler: error writing %s\n", file);
+    return ok;
+}
+
+// Every other profiled thread must have exited, and the GL context must still
+// be current.
+void Profiler_Shutdown(void) {
+    if (g_gpuReady) {
+        if (g_gpuRecording) glEndQuery(GL_TIME_ELAPSED);
+        for (int i = 0; i < PROFILER_GPU_FRAMES; i++)
+            glDeleteQueries(PROFILER_GPU_PASSES, g_gpuFrames[i].queries);
+    }
+    memset(g_gpuFrames, 0, sizeof(g_gpuFrames));
+    g_gpuThread = NULL;
+    g_gpuFrame = g_gpuDepth = 0;
+    g_gpuReady = g_gpuRecording = false;
+
+    for (int i = 0; i < g_threadCount; i++) {
+        pthread_mutex_destroy(&g_threads[i]->lock);
+        free(g_threads[i]);
+    }
+    g_threadCount = 0;
+    g_scopeCount = 0;
+    t_thread = NULL;
+    t_unregistered = false;
+}
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+#include <stdbool.h>
+#include <stddef.h>
+
+// Build with -DPROFILER_ENABLED=0 to compile every PROFILE_* macro to
+// nothing.
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 1
+#endif
+
+// Scopes per thread are kept in a ring of the last PROFILER_RING_SIZE
+// events, which is what a trace dump contains.
+#define PROFILER_RING_SIZE 16384
+#define PROFILER_MAX_DEPTH 32
+#define PROFILER_MAX_THREADS 32
+#define PROFILER_MAX_SCOPES 64
+// GPU passes per frame, and how many frames of queries are in flight before
+// the oldest one is read back.
+#define PROFILER_GPU_PASSES 8
+#define PROFILER_GPU_FRAMES 4
+
+typedef enum {
+    PROFILER_TRACK_MAIN,
+    PROFILER_TRACK_WORKERS,
+    PROFILER_TRACK_GPU
+} ProfilerTrack;
+
+#if PROFILER_ENABLED
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+// Times the rest of the enclosing block, however it is left. name must be a
+// string literal or otherwise outlive the profiler.
+#define PROFILE_SCOPE(name) \
+    __attribute__((cleanup(Profiler_EndScope))) int PROFILE_CONCAT(profileScope, __LINE__) = Profiler_Begin(name)
+#define PROFILE_BEGIN(name) Profiler_Begin(name)
+#define PROFILE_END() Profiler_End()
+// GPU passes can't nest; a pass begun inside another is ignored.
+#define PROFILE_GPU_BEGIN(name) Profiler_GpuBegin(name)
+#define PROFILE_GPU_END() Profiler_GpuEnd()
+#define PROFILE_THREAD(name) Profiler_SetThreadName(name)
+#define PROFILE_FRAME_END() Profiler_EndFrame()
+
+int Profiler_Begin(const char* name);
+void Profiler_End(void);
+void Profiler_EndScope(int* scope);
+void Profiler_GpuBegin(const char* name);
+void Profiler_GpuEnd(void);
+void Profiler_SetThreadName(const char* name);
+void Profiler_EndFrame(void);
+void Profiler_FormatOverlay(ProfilerTrack track, char* out, size_t size);
+bool Profiler_WriteTrace(const char* file);
+void Profiler_Shutdown(void);
+
+#else
+
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_BEGIN(name) ((void)0)
+#define PROFILE_END() ((void)0)
+#define PROFILE_GPU_BEGIN(name) ((void)0)
+#define PROFILE_GPU_END() ((void)0)
+#define PROFILE_THREAD(name) ((void)0)
+#define PROFILE_FRAME_END() ((void)0)
+
+#endif
+
+#endif
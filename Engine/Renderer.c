@@ -1,38 +1,31 @@
 #include "Renderer.h"
 #include "World/Lighting.h"
+#include "Memory.h"
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
-
-bool IsFaceVisible(Chunk* c, int x, int y, int z, int dx, int dy, int dz) {
-    int nx = x + dx;
-    int ny = y + dy;
-    int nz = z + dz;
-    if (nx < 0 || nx >= 32 || ny < 0 || ny >= 32 || nz < 0 || nz >= 32)
-        return true;
-    Block* n = c->blocks[nx][ny][nz];
-    if (!n) return true;
-    return !n->active;
-}
-
-static int IsBlockSolidAt(Chunk* c, int x, int y, int z, int size) {
-    if (x < 0 || x >= size || y < 0 || y >= size || z < 0 || z >= size)
-        return 0;
-    Block* b = c->blocks[x][y][z];
-    return (b && b->active) ? 1 : 0;
-}
-
-static float CalculateVertexAO(Chunk* c, int x, int y, int z, int size,
-                               int dx, int dy, int dz,
-                               int du1, int dv1, int du2, int dv2) {
-    int side1 = IsBlockSolidAt(c, x + du1, y + dv1, z + (dx ? du1 : (dy ? dv1 : du1)), size);
-    int side2 = IsBlockSolidAt(c, x + du2, y + dv2, z + (dx ? du2 : (dy ? dv2 : du2)), size);
-    int corner = IsBlockSolidAt(c, x + du1 + du2, y + dv1 + dv2, z + (dx ? (du1 + du2) : (dy ? (dv1 + dv2) : (du1 + du2))), size);
-
-    if (side1 && side2) {
-        return 0.0f;
-    }
-    return 1.0f - (side1 + side2 + corner) * 0.2f;
-}
+#include <stdatomic.h>
+
+// Every chunk mesh lives in one shared vertex buffer and is drawn through a
+// single VAO, with the section's first vertex passed as the base vertex.
+static MeshArena g_chunkArena;
+static GLuint g_chunkVAO=0;
+
+// Command layout read by glMultiDrawElementsIndirect. baseInstance indexes
+// the per-draw origin attribute, so one call can draw every section.
+typedef struct {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+} DrawElementsIndirectCommand;
+
+static GLuint g_chunkOriginBuffer=0,g_chunkIndirectBuffer=0;
+static bool g_chunkMultiDraw=false;
+static DrawElementsIndirectCommand* g_drawCommands=NULL;
+static vec3* g_drawOrigins=NULL;
+static int g_drawCapacity=0;
 
 VoxelMesh CreateVoxelMesh(float size) {
     VoxelMesh mesh = {0};
@@ -56,6 +49,7 @@ VoxelMesh CreateVoxelMesh(float size) {
     glBindVertexArray(mesh.VAO);
     glBindBuffer(GL_ARRAY_BUFFER, mesh.VBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    Memory_TrackGL(MEM_GL_BUFFER, mesh.VBO, MEM_TAG_GPU_VERTEX, sizeof(vertices));
     glVertexAttribPointer(0,3,GL_FLOAT,GL_FALSE,6*sizeof(float),(void*)0);
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(1,3,GL_FLOAT,GL_FALSE,6*sizeof(float),(void*)(3*sizeof(float)));
@@ -71,33 +65,105 @@ void DrawVoxel(const VoxelMesh* voxel, shader* s, vec3 pos, mat4 view, mat4 proj
     Shader_SetMat4(s, "model", &model);
     Shader_SetMat4(s, "view", &view);
     Shader_SetMat4(s, "projection", &projection);
-    GLint colorLoc = glGetUniformLocation(s->id, "blockColor");
-    glUniform3f(colorLoc, color.x, color.y, color.z);
+    Shader_SetVec3(s, "blockColor", color);
     glBindVertexArray(voxel->VAO);
     glDrawArrays(GL_TRIANGLES,0,voxel->vertexCount);
     glBindVertexArray(0);
 }
 
-void DrawChunk(const Chunk* c, const VoxelMesh* voxel, shader* s, mat4 view, mat4 projection, int size, vec3 camPos, float maxDist) {
-    if (!c) return;
-    if (c->meshVAO==0||c->meshVertexCount==0) return;
+static bool GrowDrawList(void){
+    int capacity=g_drawCapacity?g_drawCapacity*2:256;
+    DrawElementsIndirectCommand* commands=(DrawElementsIndirectCommand*)Memory_Realloc(MEM_TAG_MESH_SCRATCH,g_drawCommands,capacity*sizeof(DrawElementsIndirectCommand));
+    if(!commands) return false;
+    g_drawCommands=commands;
+    vec3* origins=(vec3*)Memory_Realloc(MEM_TAG_MESH_SCRATCH,g_drawOrigins,capacity*sizeof(vec3));
+    if(!origins) return false;
+    g_drawOrigins=origins;
+    g_drawCapacity=capacity;
+    return true;
+}
 
+// Culls every meshed section in the map and draws the rest. With multi-draw
+// the survivors are written out as indirect commands and submitted in one
+// call; otherwise each one is drawn on its own, its origin set through the
+// attribute's current value.
+void DrawChunks(const ChunkMap* map, shader* s, const Frustum* frustum, vec3 camPos, float maxDist, ChunkDrawStats* stats) {
     Shader_Use(s);
-    Shader_SetMat4(s,"model",&(mat4){.m={1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1}});
-    Shader_SetMat4(s,"view",&view);
-    Shader_SetMat4(s,"projection",&projection);
-    glBindVertexArray(c->meshVAO);
-    glDrawArrays(GL_TRIANGLES,0,c->meshVertexCount);
+    glBindVertexArray(g_chunkVAO);
+    if (g_chunkMultiDraw) glEnableVertexAttribArray(1);
+    else glDisableVertexAttribArray(1);
+
+    int draws=0;
+    for (int e=0;e<map->capacity;e++) {
+        const Chunk* c=map->entries[e].chunk;
+        if (!c || c->state != CHUNK_MESHED) continue;
+
+        for (int i=0;i<CHUNK_SECTIONS;i++) {
+            const ChunkSection* sec=&c->sections[i];
+            if (sec->meshVertexCount==0) continue;
+
+            int triangles = sec->meshVertexCount/2;
+            vec3 nearest = {
+                fmaxf(sec->boundsMin.x, fminf(camPos.x, sec->boundsMax.x)),
+                fmaxf(sec->boundsMin.y, fminf(camPos.y, sec->boundsMax.y)),
+                fmaxf(sec->boundsMin.z, fminf(camPos.z, sec->boundsMax.z))
+            };
+            if (Vec3LengthSquared(Vec3Subtract(nearest, camPos)) > maxDist*maxDist ||
+                !FrustumIntersectsAABB(frustum, sec->boundsMin, sec->boundsMax)) {
+                stats->culledChunks++;
+                stats->culledTriangles += triangles;
+                continue;
+            }
+            // A section the draw list has no room for isn't drawn, so it
+            // counts as culled.
+            if (g_chunkMultiDraw && draws==g_drawCapacity && !GrowDrawList()) {
+                stats->culledChunks++;
+                stats->culledTriangles += triangles;
+                continue;
+            }
+            stats->drawnChunks++;
+            stats->drawnTriangles += triangles;
+
+            if (!g_chunkMultiDraw) {
+                glVertexAttrib3f(1,sec->origin.x,sec->origin.y,sec->origin.z);
+                glDrawElementsBaseVertex(GL_TRIANGLES,sec->meshVertexCount/4*6,GL_UNSIGNED_INT,(void*)0,sec->meshFirst);
+                continue;
+            }
+            g_drawCommands[draws]=(DrawElementsIndirectCommand){sec->meshVertexCount/4*6,1,0,(GLint)sec->meshFirst,(GLuint)draws};
+            g_drawOrigins[draws++]=sec->origin;
+        }
+    }
+
+    if (draws>0) {
+        glBindBuffer(GL_ARRAY_BUFFER,g_chunkOriginBuffer);
+        glBufferData(GL_ARRAY_BUFFER,draws*sizeof(vec3),g_drawOrigins,GL_STREAM_DRAW);
+        Memory_TrackGL(MEM_GL_BUFFER,g_chunkOriginBuffer,MEM_TAG_GPU_VERTEX,draws*sizeof(vec3));
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER,g_chunkIndirectBuffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER,draws*sizeof(DrawElementsIndirectCommand),g_drawCommands,GL_STREAM_DRAW);
+        Memory_TrackGL(MEM_GL_BUFFER,g_chunkIndirectBuffer,MEM_TAG_GPU_VERTEX,draws*sizeof(DrawElementsIndirectCommand));
+        glMultiDrawElementsIndirect(GL_TRIANGLES,GL_UNSIGNED_INT,(void*)0,draws,0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER,0);
+    }
     glBindVertexArray(0);
 }
 
+void SetChunkShaderConstants(shader* s, float voxelSize) {
+    vec3 palette[BLOCK_TYPE_COUNT];
+    for (int i = 0; i < BLOCK_TYPE_COUNT; i++)
+        palette[i] = BlockTypeToColor((block_type)i);
+
+    Shader_Use(s);
+    Shader_SetFloat(s, "voxelSize", voxelSize);
+    glUniform3fv(Shader_Location(s, "blockPalette"), BLOCK_TYPE_COUNT, &palette[0].x);
+}
+
 SkyDome CreateSkyDome(int slices, int stacks, vec3 topColor, vec3 bottomColor) {
     SkyDome dome = {0};
     dome.topColor = topColor;
     dome.bottomColor = bottomColor;
 
     int vertCount = slices * stacks * 6;
-    float* data = malloc(vertCount * 6 * sizeof(float));
+    float* data = Memory_Alloc(MEM_TAG_MESH_SCRATCH, vertCount * 6 * sizeof(float));
     if(!data) return dome;
 
     int idx = 0;
@@ -159,6 +225,7 @@ SkyDome CreateSkyDome(int slices, int stacks, vec3 topColor, vec3 bottomColor) {
     glBindVertexArray(dome.VAO);
     glBindBuffer(GL_ARRAY_BUFFER, dome.VBO);
     glBufferData(GL_ARRAY_BUFFER, idx * sizeof(float), data, GL_STATIC_DRAW);
+    Memory_TrackGL(MEM_GL_BUFFER, dome.VBO, MEM_TAG_GPU_VERTEX, idx * sizeof(float));
 
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6*sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
@@ -167,22 +234,15 @@ SkyDome CreateSkyDome(int slices, int stacks, vec3 topColor, vec3 bottomColor) {
     glEnableVertexAttribArray(1);
 
     glBindVertexArray(0);
-    free(data);
+    Memory_Free(MEM_TAG_MESH_SCRATCH, data);
 
     return dome;
 }
 
-void DrawSkyDome(SkyDome* dome, shader* s, mat4 view, mat4 projection) {
+void DrawSkyDome(SkyDome* dome, shader* s) {
     glDepthMask(GL_FALSE);
     Shader_Use(s);
 
-    mat4 viewNoTrans = view;
-    viewNoTrans.m[12] = 0;
-    viewNoTrans.m[13] = 0;
-    viewNoTrans.m[14] = 0;
-    Shader_SetMat4(s, "view", &viewNoTrans);
-    Shader_SetMat4(s, "projection", &projection);
-
     glBindVertexArray(dome->VAO);
     glDrawArrays(GL_TRIANGLES, 0, dome->vertexCount);
     glBindVertexArray(0);
@@ -193,107 +253,338 @@ void DrawSkyDome(SkyDome* dome, shader* s, mat4 view, mat4 projection) {
 void FreeSkyDome(SkyDome* dome){
     if(!dome) return;
     if(dome->VAO){glDeleteVertexArrays(1,&dome->VAO);dome->VAO=0;}
-    if(dome->VBO){glDeleteBuffers(1,&dome->VBO);dome->VBO=0;}
+    if(dome->VBO){Memory_UntrackGL(MEM_GL_BUFFER,dome->VBO);glDeleteBuffers(1,&dome->VBO);dome->VBO=0;}
     dome->vertexCount=0;
 }
 
-void BuildChunkMesh(Chunk* c,int size,float voxelSize) {
-    if(!c) return;
-    if(c->meshVAO){glDeleteVertexArrays(1,&c->meshVAO);c->meshVAO=0;}
-    if(c->meshVBO){glDeleteBuffers(1,&c->meshVBO);c->meshVBO=0;}
-    c->meshVertexCount=0;
-    float* data=NULL;
-    size_t capacity=0,count=0;
-    float s=voxelSize*0.5f;
-
-    const int faces[6][3]={{0,0,1},{0,0,-1},{-1,0,0},{1,0,0},{0,1,0},{0,-1,0}};
-    const float faceVerts[6][6][3]={{
-        {-s,-s,s},{s,-s,s},{s,s,s},{-s,-s,s},{s,s,s},{-s,s,s}},
-        {{s,-s,-s},{-s,-s,-s},{-s,s,-s},{s,-s,-s},{-s,s,-s},{s,s,-s}},
-        {{-s,-s,-s},{-s,-s,s},{-s,s,s},{-s,-s,-s},{-s,s,s},{-s,s,-s}},
-        {{s,-s,s},{s,-s,-s},{s,s,-s},{s,-s,s},{s,s,-s},{s,s,s}},
-        {{-s,s,s},{s,s,s},{s,s,-s},{-s,s,s},{s,s,-s},{-s,s,-s}},
-        {{-s,-s,-s},{s,-s,-s},{s,-s,s},{-s,-s,-s},{s,-s,s},{-s,-s,s}}
-    };
-    const float faceNormals[6][3]={{0,0,1},{0,0,-1},{-1,0,0},{1,0,0},{0,1,0},{0,-1,0}};
-
-    const int aoOffsets[6][4][3] = {
-        {{-1,-1,0},{1,-1,0},{1,1,0},{-1,1,0}},
-        {{1,-1,0},{-1,-1,0},{-1,1,0},{1,1,0}},
-        {{0,-1,-1},{0,-1,1},{0,1,1},{0,1,-1}},
-        {{0,-1,1},{0,-1,-1},{0,1,-1},{0,1,1}},
-        {{-1,0,-1},{1,0,-1},{1,0,1},{-1,0,1}},
-        {{-1,0,1},{1,0,1},{1,0,-1},{-1,0,-1}}
-    };
+static atomic_int g_chunkMesher = CHUNK_MESHER_NAIVE;
+static GLuint g_quadIndexBuffer = 0;
 
-    for(int x=0;x<size;x++) for(int y=0;y<size;y++) for(int z=0;z<size;z++){
-        Block* b=c->blocks[x][y][z];
-        if(!b||!b->active) continue;
-        for(int f=0;f<6;f++){
-            int dx=faces[f][0],dy=faces[f][1],dz=faces[f][2];
-            if(!IsFaceVisible(c,x,y,z,dx,dy,dz)) continue;
-            size_t need=count+6*10;
-            if(need>capacity){
-                size_t newcap=capacity?capacity*2:1024;
-                while(newcap<need) newcap*=2;
-                float* tmp=(float*)realloc(data,newcap*sizeof(float));
-                if(!tmp){free(data);return;}
-                data=tmp;capacity=newcap;
-            }
+bool CreateChunkIndexBuffer(void) {
+    size_t count = (size_t)CHUNK_MAX_QUADS * 6;
+    GLuint* indices = (GLuint*)Memory_Alloc(MEM_TAG_MESH_SCRATCH, count * sizeof(GLuint));
+    if (!indices) return false;
+
+    for (GLuint q = 0; q < CHUNK_MAX_QUADS; q++) {
+        GLuint* idx = indices + q * 6;
+        GLuint base = q * 4;
+        idx[0] = base; idx[1] = base + 1; idx[2] = base + 2;
+        idx[3] = base; idx[4] = base + 2; idx[5] = base + 3;
+    }
+
+    glGenBuffers(1, &g_quadIndexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, g_quadIndexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, count * sizeof(GLuint), indices, GL_STATIC_DRAW);
+    Memory_TrackGL(MEM_GL_BUFFER, g_quadIndexBuffer, MEM_TAG_GPU_VERTEX, count * sizeof(GLuint));
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    Memory_Free(MEM_TAG_MESH_SCRATCH, indices);
+    return true;
+}
+
+void FreeChunkIndexBuffer(void) {
+    if (g_quadIndexBuffer) {
+        Memory_UntrackGL(MEM_GL_BUFFER, g_quadIndexBuffer);
+        glDeleteBuffers(1, &g_quadIndexBuffer);
+        g_quadIndexBuffer = 0;
+    }
+}
 
-            float ao[4];
-            for(int i=0;i<4;i++){
-                int ox=aoOffsets[f][i][0];
-                int oy=aoOffsets[f][i][1];
-                int oz=aoOffsets[f][i][2];
+void SetChunkMesher(ChunkMesher mesher) {
+    atomic_store(&g_chunkMesher, mesher);
+}
+
+ChunkMesher GetChunkMesher(void) {
+    return (ChunkMesher)atomic_load(&g_chunkMesher);
+}
+
+static const int faceDirs[6][3]={{0,0,1},{0,0,-1},{-1,0,0},{1,0,0},{0,1,0},{0,-1,0}};
+static const int faceCorners[6][4][3]={
+    {{-1,-1,1},{1,-1,1},{1,1,1},{-1,1,1}},
+    {{1,-1,-1},{-1,-1,-1},{-1,1,-1},{1,1,-1}},
+    {{-1,-1,-1},{-1,-1,1},{-1,1,1},{-1,1,-1}},
+    {{1,-1,1},{1,-1,-1},{1,1,-1},{1,1,1}},
+    {{-1,1,1},{1,1,1},{1,1,-1},{-1,1,-1}},
+    {{-1,-1,-1},{1,-1,-1},{1,-1,1},{-1,-1,1}}
+};
+// Every quad is drawn with indices {0,1,2, 0,2,3}. Emitting the corners
+// rotated by one selects the other diagonal, which keeps AO interpolation
+// from smearing a lone occluded corner across the whole face.
+static const int quadCornerOrder[2][4]={{0,1,2,3},{1,2,3,0}};
+static const int aoOffsets[6][4][3]={
+    {{-1,-1,0},{1,-1,0},{1,1,0},{-1,1,0}},
+    {{1,-1,0},{-1,-1,0},{-1,1,0},{1,1,0}},
+    {{0,-1,-1},{0,-1,1},{0,1,1},{0,1,-1}},
+    {{0,-1,1},{0,-1,-1},{0,1,-1},{0,1,1}},
+    {{-1,0,-1},{1,0,-1},{1,0,1},{-1,0,1}},
+    {{-1,0,1},{1,0,1},{1,0,-1},{-1,0,-1}}
+};
+// Visibility and AO of one face direction for every row of the chunk, as
+// x-bitmasks indexed [y][z]. AO levels are stored as two bit planes per corner.
+typedef struct {
+    uint32_t visible[CHUNK_SIZE][CHUNK_SIZE];
+    uint32_t aoLo[4][CHUNK_SIZE][CHUNK_SIZE];
+    uint32_t aoHi[4][CHUNK_SIZE][CHUNK_SIZE];
+} FaceMasks;
+
+// Bit x of the result is set when (x+ox, y, z) is solid.
+static inline uint32_t SolidRow(const ChunkNeighborhood* nb,int y,int z,int ox){
+    return (uint32_t)(nb->solid[y+1][z+1]>>(ox+1));
+}
 
-                int side1=IsBlockSolidAt(c,x+ox,y+oy,z+oz,size);
-                int side2=IsBlockSolidAt(c,x+dx,y+dy,z+dz,size);
-                int corner=IsBlockSolidAt(c,x+ox+dx,y+oy+dy,z+oz+dz,size);
+static void BuildFaceMasks(const ChunkNeighborhood* nb,int f,FaceMasks* fm){
+    int dx=faceDirs[f][0],dy=faceDirs[f][1],dz=faceDirs[f][2];
+    for(int y=0;y<CHUNK_SIZE;y++) for(int z=0;z<CHUNK_SIZE;z++){
+        uint32_t visible=SolidRow(nb,y,z,0)&~SolidRow(nb,y+dy,z+dz,dx);
+        fm->visible[y][z]=visible;
+        if(!visible) continue;
+
+        // The face neighbour is open wherever the face is visible, so the
+        // level is just side + diagonal and never reaches 3.
+        for(int i=0;i<4;i++){
+            int ox=aoOffsets[f][i][0],oy=aoOffsets[f][i][1],oz=aoOffsets[f][i][2];
+            uint32_t side=SolidRow(nb,y+oy,z+oz,ox);
+            uint32_t diag=SolidRow(nb,y+oy+dy,z+oz+dz,ox+dx);
+            fm->aoLo[i][y][z]=side^diag;
+            fm->aoHi[i][y][z]=side&diag;
+        }
+    }
+}
+
+static inline void FaceMaskAO(const FaceMasks* fm,int x,int y,int z,int ao[4]){
+    for(int i=0;i<4;i++)
+        ao[i]=(int)((fm->aoLo[i][y][z]>>x)&1)|(int)(((fm->aoHi[i][y][z]>>x)&1)<<1);
+}
 
-                if(side1&&side2) ao[i]=0.2f;
-                else ao[i]=1.0f-(side1+side2+corner)*0.18f;
+static bool ReserveMeshData(ChunkMeshData* m,size_t* capacity,size_t extra){
+    size_t need=m->count+extra;
+    if(need<=*capacity) return true;
+    size_t newcap=*capacity?*capacity*2:256;
+    while(newcap<need) newcap*=2;
+    ChunkVertex* tmp=(ChunkVertex*)Memory_Realloc(MEM_TAG_MESH_SCRATCH,m->vertices,newcap*sizeof(ChunkVertex));
+    if(!tmp) return false;
+    m->vertices=tmp;
+    *capacity=newcap;
+    return true;
+}
+
+// Emits the four corners of face f covering the voxel box lo..hi (inclusive).
+// Corners are stored as chunk-local lattice points 0..32, where point k sits
+// half a voxel below voxel k.
+static void EmitQuad(ChunkMeshData* m,int f,const int lo[3],const int hi[3],
+                     block_type type,const int ao[4]){
+    int flip=ao[0]+ao[2]>ao[1]+ao[3];
+    for(int i=0;i<4;i++){
+        int corner=quadCornerOrder[flip][i];
+        int p[3];
+        for(int a=0;a<3;a++)
+            p[a]=faceCorners[f][corner][a]<0?lo[a]:hi[a]+1;
+        m->vertices[m->count++]=PackChunkVertex(p[0],p[1],p[2],f,ao[corner],type);
+    }
+}
+
+static bool MeshChunkNaive(const ChunkNeighborhood* nb,int size,ChunkMeshData* m,size_t* capacity){
+    FaceMasks fm;
+    for(int f=0;f<6;f++){
+        BuildFaceMasks(nb,f,&fm);
+        for(int y=0;y<size;y++) for(int z=0;z<size;z++){
+            for(uint32_t bits=fm.visible[y][z];bits;bits&=bits-1){
+                int x=__builtin_ctz(bits);
+                int cell[3]={x,y,z};
+                if(!ReserveMeshData(m,capacity,4)) return false;
+
+                int ao[4];
+                FaceMaskAO(&fm,x,y,z,ao);
+                EmitQuad(m,f,cell,cell,GetNeighborhoodBlock(nb,x,y,z),ao);
             }
+        }
+    }
+    return true;
+}
 
-            int vertOrder[6]={0,1,2,0,2,3};
-            for(int vi=0;vi<6;vi++){
-                int aoIdx=vertOrder[vi];
-                float vx=faceVerts[f][vi][0]+b->position.x;
-                float vy=faceVerts[f][vi][1]+b->position.y;
-                float vz=faceVerts[f][vi][2]+b->position.z;
-                float nx=faceNormals[f][0],ny=faceNormals[f][1],nz=faceNormals[f][2];
-
-                data[count++]=vx;data[count++]=vy;data[count++]=vz;
-                data[count++]=nx;data[count++]=ny;data[count++]=nz;
-                data[count++]=b->color.x;
-                data[count++]=b->color.y;
-                data[count++]=b->color.z;
-                data[count++]=ao[aoIdx];
+// Merges coplanar faces of the same block type into larger quads. Only faces
+// whose four AO corners agree are merged, so the result shades exactly like
+// the naive mesh; faces with an AO gradient are emitted one by one.
+static bool MeshChunkGreedy(const ChunkNeighborhood* nb,int size,ChunkMeshData* m,size_t* capacity){
+    uint16_t mask[CHUNK_SIZE*CHUNK_SIZE];
+    FaceMasks fm;
+    for(int f=0;f<6;f++){
+        BuildFaceMasks(nb,f,&fm);
+        int n=faceDirs[f][0]?0:(faceDirs[f][1]?1:2);
+        int u=(n+1)%3,v=(n+2)%3;
+        for(int d=0;d<size;d++){
+            memset(mask,0,sizeof(mask));
+            bool any=false;
+
+            // Walk only the rows that cross layer d: every row for x faces
+            // (testing bit d), a single y or z slice otherwise.
+            int y0=n==1?d:0,y1=n==1?d:size-1;
+            int z0=n==2?d:0,z1=n==2?d:size-1;
+            for(int y=y0;y<=y1;y++) for(int z=z0;z<=z1;z++){
+                uint32_t bits=fm.visible[y][z];
+                if(n==0) bits&=1u<<d;
+                for(;bits;bits&=bits-1){
+                    int p[3]={__builtin_ctz(bits),y,z};
+                    block_type type=GetNeighborhoodBlock(nb,p[0],p[1],p[2]);
+                    int ao[4];
+                    FaceMaskAO(&fm,p[0],p[1],p[2],ao);
+                    if(ao[0]==ao[1]&&ao[1]==ao[2]&&ao[2]==ao[3]){
+                        mask[p[v]*size+p[u]]=(uint16_t)((type<<3)|(ao[0]<<1)|1);
+                        any=true;
+                        continue;
+                    }
+                    if(!ReserveMeshData(m,capacity,4)) return false;
+                    EmitQuad(m,f,p,p,type,ao);
+                }
             }
+            if(!any) continue;
+
+            for(int a=0;a<size;a++) for(int b=0;b<size;){
+                uint16_t key=mask[a*size+b];
+                if(!key){b++;continue;}
+
+                int w=1;
+                while(b+w<size&&mask[a*size+b+w]==key) w++;
+                int h=1;
+                for(;a+h<size;h++){
+                    int k=0;
+                    while(k<w&&mask[(a+h)*size+b+k]==key) k++;
+                    if(k<w) break;
+                }
+                for(int da=0;da<h;da++) for(int db=0;db<w;db++) mask[(a+da)*size+b+db]=0;
+
+                int lo[3],hi[3];
+                lo[n]=hi[n]=d;
+                lo[u]=b;hi[u]=b+w-1;
+                lo[v]=a;hi[v]=a+h-1;
+                int level=(key>>1)&3;
+                int ao[4]={level,level,level,level};
+                if(!ReserveMeshData(m,capacity,4)) return false;
+                EmitQuad(m,f,lo,hi,(block_type)(key>>3),ao);
+                b+=w;
+            }
+        }
+    }
+    return true;
+}
+
+bool GenerateChunkMeshData(const ChunkNeighborhood* nb,int size,float voxelSize,ChunkMeshData* out) {
+    out->vertices=NULL;
+    out->count=0;
+    if(!nb) return false;
+
+    size_t capacity=0;
+    bool ok=GetChunkMesher()==CHUNK_MESHER_GREEDY
+        ?MeshChunkGreedy(nb,size,out,&capacity)
+        :MeshChunkNaive(nb,size,out,&capacity);
+    if(!ok){FreeChunkMeshData(out);return false;}
+
+    // Lattice point k sits half a voxel below voxel k.
+    int lo[3]={CHUNK_SIZE,CHUNK_SIZE,CHUNK_SIZE},hi[3]={0,0,0};
+    for(size_t i=0;i<out->count;i++){
+        uint32_t v=out->vertices[i].lo;
+        int p[3]={v&63,(v>>6)&63,(v>>12)&63};
+        for(int a=0;a<3;a++){
+            if(p[a]<lo[a]) lo[a]=p[a];
+            if(p[a]>hi[a]) hi[a]=p[a];
         }
     }
-    if(count==0){free(data);return;}
-    glGenVertexArrays(1,&c->meshVAO);
-    glGenBuffers(1,&c->meshVBO);
-    glBindVertexArray(c->meshVAO);
-    glBindBuffer(GL_ARRAY_BUFFER,c->meshVBO);
-    glBufferData(GL_ARRAY_BUFFER,count*sizeof(float),data,GL_STATIC_DRAW);
-    glVertexAttribPointer(0,3,GL_FLOAT,GL_FALSE,10*sizeof(float),(void*)0);
+    out->boundsMin=(vec3){(lo[0]-0.5f)*voxelSize,(lo[1]-0.5f)*voxelSize,(lo[2]-0.5f)*voxelSize};
+    out->boundsMax=(vec3){(hi[0]-0.5f)*voxelSize,(hi[1]-0.5f)*voxelSize,(hi[2]-0.5f)*voxelSize};
+    return true;
+}
+
+// Points the VAO at the arena; needed again whenever the arena grows.
+static void BindChunkArena(void){
+    glBindVertexArray(g_chunkVAO);
+    glBindBuffer(GL_ARRAY_BUFFER,g_chunkArena.buffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,g_quadIndexBuffer);
+    glVertexAttribIPointer(0,2,GL_UNSIGNED_INT,sizeof(ChunkVertex),(void*)0);
     glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1,3,GL_FLOAT,GL_FALSE,10*sizeof(float),(void*)(3*sizeof(float)));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2,3,GL_FLOAT,GL_FALSE,10*sizeof(float),(void*)(6*sizeof(float)));
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(3,1,GL_FLOAT,GL_FALSE,10*sizeof(float),(void*)(9*sizeof(float)));
-    glEnableVertexAttribArray(3);
+    if(g_chunkOriginBuffer){
+        glBindBuffer(GL_ARRAY_BUFFER,g_chunkOriginBuffer);
+        glVertexAttribPointer(1,3,GL_FLOAT,GL_FALSE,sizeof(vec3),(void*)0);
+        glVertexAttribDivisor(1,1);
+    }
     glBindVertexArray(0);
-    c->meshVertexCount=count/10;
-    free(data);
+}
+
+// Needs the chunk index buffer to exist already.
+bool CreateChunkMeshArena(size_t bytes,size_t stagingBytes){
+    if(!MeshArena_Init(&g_chunkArena,bytes,stagingBytes)) return false;
+    glGenVertexArrays(1,&g_chunkVAO);
+    if((GLEW_VERSION_4_3||GLEW_ARB_multi_draw_indirect)&&(GLEW_VERSION_4_2||GLEW_ARB_base_instance)){
+        glGenBuffers(1,&g_chunkOriginBuffer);
+        glGenBuffers(1,&g_chunkIndirectBuffer);
+        g_chunkMultiDraw=true;
+    }
+    BindChunkArena();
+    return true;
+}
+
+void FreeChunkMeshArena(void){
+    MeshArena_Destroy(&g_chunkArena);
+    if(g_chunkVAO){glDeleteVertexArrays(1,&g_chunkVAO);g_chunkVAO=0;}
+    if(g_chunkOriginBuffer){Memory_UntrackGL(MEM_GL_BUFFER,g_chunkOriginBuffer);glDeleteBuffers(1,&g_chunkOriginBuffer);g_chunkOriginBuffer=0;}
+    if(g_chunkIndirectBuffer){Memory_UntrackGL(MEM_GL_BUFFER,g_chunkIndirectBuffer);glDeleteBuffers(1,&g_chunkIndirectBuffer);g_chunkIndirectBuffer=0;}
+    g_chunkMultiDraw=false;
+    Memory_Free(MEM_TAG_MESH_SCRATCH,g_drawCommands);Memory_Free(MEM_TAG_MESH_SCRATCH,g_drawOrigins);
+    g_drawCommands=NULL;g_drawOrigins=NULL;
+    g_drawCapacity=0;
+}
+
+// Multi-draw needs GL 4.3 (or ARB_multi_draw_indirect) plus base instance;
+// without them sections are always drawn one call at a time.
+bool ChunkMultiDrawSupported(void){
+    return g_chunkIndirectBuffer!=0;
+}
+
+void SetChunkMultiDraw(bool enabled){
+    g_chunkMultiDraw=enabled&&g_chunkIndirectBuffer;
+}
+
+bool GetChunkMultiDraw(void){
+    return g_chunkMultiDraw;
+}
+
+void FenceChunkMeshUploads(void){
+    MeshArena_Fence(&g_chunkArena);
+}
+
+MeshArenaStats GetChunkMeshArenaStats(void){
+    return MeshArena_Stats(&g_chunkArena);
+}
+
+static void FreeSectionMesh(ChunkSection* s){
+    if(s->meshVertexCount)
+        MeshArena_Release(&g_chunkArena,(size_t)s->meshFirst*sizeof(ChunkVertex),s->meshVertexCount*sizeof(ChunkVertex));
+    s->meshFirst=0;
+    s->meshVertexCount=0;
+}
+
+void UploadChunkMesh(ChunkSection* s,const ChunkMeshData* mesh) {
+    if(!s) return;
+    FreeSectionMesh(s);
+    if(mesh->count==0||!g_chunkVAO) return;
+    s->boundsMin=Vec3Add(s->origin,mesh->boundsMin);
+    s->boundsMax=Vec3Add(s->origin,mesh->boundsMax);
+
+    size_t bytes=mesh->count*sizeof(ChunkVertex),offset;
+    while(!MeshArena_Alloc(&g_chunkArena,bytes,&offset)){
+        if(!MeshArena_Grow(&g_chunkArena)) return;
+        BindChunkArena();
+    }
+    MeshArena_Upload(&g_chunkArena,offset,mesh->vertices,bytes);
+    s->meshFirst=(GLuint)(offset/sizeof(ChunkVertex));
+    s->meshVertexCount=mesh->count;
+}
+
+void FreeChunkMeshData(ChunkMeshData* mesh) {
+    Memory_Free(MEM_TAG_MESH_SCRATCH,mesh->vertices);
+    mesh->vertices=NULL;
+    mesh->count=0;
 }
 
 void FreeChunkMesh(Chunk* c){
     if(!c) return;
-    if(c->meshVAO){glDeleteVertexArrays(1,&c->meshVAO);c->meshVAO=0;}
-    if(c->meshVBO){glDeleteBuffers(1,&c->meshVBO);c->meshVBO=0;}
-    c->meshVertexCount=0;
+    for(int i=0;i<CHUNK_SECTIONS;i++) FreeSectionMesh(&c->sections[i]);
 }
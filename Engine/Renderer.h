@@ -1,5 +1,6 @@
 #ifndef RENDERER_H
 #define RENDERER_H
+#include "MeshArena.h"
 #include "Shaderer.h"
 #include "World/Block.h"
 #include "utils/MathUtil.h"
@@ -11,6 +12,43 @@ typedef struct {
   GLuint vertexCount;
 } VoxelMesh;
 
+// Packed 8-byte chunk vertex. lo: x, y, z lattice coordinates (6 bits each),
+// face index (3 bits), AO level (2 bits). hi: block ID, whose colour comes
+// from the blockPalette uniform.
+typedef struct {
+  uint32_t lo;
+  uint32_t hi;
+} ChunkVertex;
+
+static inline ChunkVertex PackChunkVertex(int x, int y, int z, int face, int ao,
+                                          block_type type) {
+  return (ChunkVertex){(uint32_t)x | (uint32_t)y << 6 | (uint32_t)z << 12 |
+                           (uint32_t)face << 18 | (uint32_t)ao << 21,
+                       (uint32_t)type};
+}
+
+// boundsMin/boundsMax are the mesh extents relative to the chunk position.
+typedef struct {
+  ChunkVertex *vertices;
+  size_t count;
+  vec3 boundsMin;
+  vec3 boundsMax;
+} ChunkMeshData;
+
+// Counts are per chunk section.
+typedef struct {
+  int drawnChunks;
+  int culledChunks;
+  long drawnTriangles;
+  long culledTriangles;
+} ChunkDrawStats;
+
+typedef enum { CHUNK_MESHER_NAIVE, CHUNK_MESHER_GREEDY } ChunkMesher;
+
+// Worst case is a 3D checkerboard: half the voxels solid, all six faces
+// visible. Chunk meshes are 4 vertices per quad and share one index buffer.
+#define CHUNK_MAX_QUADS (CHUNK_VOLUME / 2 * 6)
+
 typedef struct {
   GLuint VAO;
   GLuint VBO;
@@ -22,14 +60,28 @@ typedef struct {
 VoxelMesh CreateVoxelMesh(float size);
 void DrawVoxel(const VoxelMesh *voxel, shader *s, vec3 pos, mat4 view,
                mat4 projection, vec3 color);
-bool IsFaceVisible(Chunk *c, int x, int y, int z, int dx, int dy, int dz);
-void DrawChunk(const Chunk *c, const VoxelMesh *voxel, shader *s, mat4 view,
-               mat4 projection, int size, vec3 camPos, float maxDist);
-void BuildChunkMesh(Chunk *c, int size, float voxelSize);
+void DrawChunks(const ChunkMap *map, shader *s, const Frustum *frustum,
+                vec3 camPos, float maxDist, ChunkDrawStats *stats);
+bool CreateChunkIndexBuffer(void);
+void FreeChunkIndexBuffer(void);
+void SetChunkMesher(ChunkMesher mesher);
+ChunkMesher GetChunkMesher(void);
+bool GenerateChunkMeshData(const ChunkNeighborhood *nb, int size, float voxelSize,
+                           ChunkMeshData *out);
+void UploadChunkMesh(ChunkSection *s, const ChunkMeshData *mesh);
+void FreeChunkMeshData(ChunkMeshData *mesh);
+void SetChunkShaderConstants(shader *s, float voxelSize);
 void FreeChunkMesh(Chunk *c);
+bool CreateChunkMeshArena(size_t bytes, size_t stagingBytes);
+void FreeChunkMeshArena(void);
+void FenceChunkMeshUploads(void);
+MeshArenaStats GetChunkMeshArenaStats(void);
+bool ChunkMultiDrawSupported(void);
+void SetChunkMultiDraw(bool enabled);
+bool GetChunkMultiDraw(void);
 
 SkyDome CreateSkyDome(int slices, int stacks, vec3 topColor, vec3 bottomColor);
-void DrawSkyDome(SkyDome *dome, shader *s, mat4 view, mat4 projection);
+void DrawSkyDome(SkyDome *dome, shader *s);
 void FreeSkyDome(SkyDome *dome);
 
 #endif
@@ -0,0 +1,186 @@
+#include "Scene.h"
+#include "Profiler.h"
+#include "World/ChunkPool.h"
+#include "utils/FreeUtil.h"
+#include <GL/glew.h>
+#include <SDL3/SDL.h>
+#include <stdio.h>
+
+#define VIEW_DISTANCE 100.0f
+#define RENDER_DISTANCE 5
+#define CHUNK_WORKER_THREADS 4
+#define CHUNK_UPDATE_INTERVAL 0.25f
+#define CHUNK_STREAM_BUDGET_MS 4.0
+#define CHUNK_VOXEL_BUDGET (32u << 20)
+#define CHUNK_GPU_BUDGET (64u << 20)
+#define CHUNK_COMPRESSED_BUDGET (16u << 20)
+#define CHUNK_POOL_SIZE 256
+#define CHUNK_ARENA_SIZE (64u << 20)
+#define CHUNK_STAGING_SIZE (8u << 20)
+#define FOG_START 20.0f
+#define FOG_END 32.0f
+#define FOG_COLOR {0.7f, 0.85f, 0.95f, 1.0f}
+
+// Loads everything around the spawn point before returning. Without a save
+// directory, or if it can't be opened, chunks are simply regenerated every
+// time.
+bool Scene_Init(Scene *scene, int seed, const char *saveDirectory) {
+  *scene = (Scene){0};
+
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  glEnable(GL_DEPTH_TEST);
+  glEnable(GL_MULTISAMPLE);
+
+  InitWorldSeed(seed);
+
+  InitPlayer(&scene->player,
+             (vec3){CHUNK_SIZE * 0.2f * 0.5f, 25.0f, CHUNK_SIZE * 0.2f * 0.5f});
+
+  scene->sunlight = (DirectionalLight){.direction = {-0.2f, -1.0f, -0.4f},
+                                       .color = {1.0f, 0.98f, 0.95f},
+                                       .ambient = 0.4f,
+                                       .diffuse = 0.6f,
+                                       .specular = 0.2f};
+
+  if (!Shader_CreateFrameUniforms())
+    return false;
+
+  scene->cubeMesh = CreateVoxelMesh(0.2f);
+  scene->cubeShader =
+      Shader_Load("Shaders/voxel/cube.vert", "Shaders/voxel/cube.frag");
+  SetChunkShaderConstants(&scene->cubeShader, 0.2f);
+  if (!CreateChunkIndexBuffer())
+    goto failShaders;
+  if (!CreateChunkMeshArena(CHUNK_ARENA_SIZE, CHUNK_STAGING_SIZE))
+    goto failIndexBuffer;
+  if (!ChunkMap_Init(&scene->chunkMap, 64))
+    goto failArena;
+
+  ChunkPool_Start(CHUNK_POOL_SIZE);
+
+  if (saveDirectory &&
+      RegionStore_Open(&scene->regionStore, saveDirectory, GetWorldSeed()))
+    scene->store = &scene->regionStore;
+
+  // Without a worker nothing queued would ever finish, and the flush below
+  // would wait forever.
+  if (!ChunkWorkers_Start(&scene->chunkWorkers, CHUNK_WORKER_THREADS,
+                          CHUNK_SIZE, 0.2f, scene->store)) {
+    printf("Scene: could not start the chunk workers\n");
+    goto failWorkers;
+  }
+  ChunkCache_Init(&scene->chunkCache, CHUNK_VOXEL_BUDGET, CHUNK_GPU_BUDGET,
+                  CHUNK_COMPRESSED_BUDGET, scene->store);
+
+  scene->chunkView = (ChunkView){scene->player.position,
+                                 CameraFront(&scene->player.cam),
+                                 scene->player.velocity};
+  UpdateChunkLoading(&scene->chunkMap, &scene->chunkWorkers,
+                     &scene->chunkCache, &scene->chunkView, 0.2f, CHUNK_SIZE,
+                     RENDER_DISTANCE);
+  ChunkWorkers_Flush(&scene->chunkWorkers, &scene->chunkMap);
+
+  scene->skyShader =
+      Shader_Load("Shaders/skybox/sky.vert", "Shaders/skybox/sky.frag");
+  scene->skyDome = CreateSkyDome(64, 32, (vec3){0.5f, 0.7f, 0.95f},
+                                 (vec3){0.9f, 0.95f, 1.0f});
+  return true;
+
+failWorkers:
+  if (scene->store)
+    RegionStore_Close(scene->store);
+  ChunkPool_Stop();
+  ChunkMap_Free(&scene->chunkMap);
+failArena:
+  FreeChunkMeshArena();
+failIndexBuffer:
+  FreeChunkIndexBuffer();
+failShaders:
+  FreeShader(1, &scene->cubeMesh.VBO, &scene->cubeShader);
+  Shader_FreeFrameUniforms();
+  return false;
+}
+
+// Streams chunks around wherever the player is now.
+void Scene_Update(Scene *scene, float deltaTime) {
+  PROFILE_SCOPE("Stream");
+  scene->chunkUpdateTimer += deltaTime;
+  if (scene->chunkUpdateTimer >= CHUNK_UPDATE_INTERVAL) {
+    PROFILE_SCOPE("ChunkLoading");
+    scene->chunkView = (ChunkView){scene->player.position,
+                                   CameraFront(&scene->player.cam),
+                                   scene->player.velocity};
+    UpdateChunkLoading(&scene->chunkMap, &scene->chunkWorkers,
+                       &scene->chunkCache, &scene->chunkView, 0.2f, CHUNK_SIZE,
+                       RENDER_DISTANCE);
+    scene->chunkUpdateTimer = 0.0f;
+  }
+  PROFILE_BEGIN("ProcessCompleted");
+  ChunkWorkers_ProcessCompleted(&scene->chunkWorkers, &scene->chunkMap,
+                                CHUNK_STREAM_BUDGET_MS);
+  PROFILE_END();
+}
+
+// Draws into whatever framebuffer is bound; width and height only set the
+// aspect ratio.
+void Scene_Render(Scene *scene, int width, int height) {
+  PROFILE_SCOPE("Render");
+  glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+  camera *cam = &scene->player.cam;
+  float aspect = (float)width / height;
+  mat4 projection = Perspective(60.0f, aspect, 0.1f, 200.0f);
+  vec3 front = CameraFront(cam);
+  vec3 target = Vec3Add(cam->pos, front);
+  vec3 up = {0.0f, 1.0f, 0.0f};
+  mat4 view = LookAt(cam->pos, target, up);
+  Frustum frustum = FrustumFromMatrix(Mat4Multiply(projection, view));
+
+  FrameUniforms frameUniforms = {
+      .view = view,
+      .projection = projection,
+      .viewPos = {cam->pos.x, cam->pos.y, cam->pos.z, 1.0f},
+      .fogColor = FOG_COLOR,
+      .fogRange = {FOG_START, FOG_END, 0.0f, 0.0f}};
+  SetDirectionalLightUniforms(&scene->sunlight, &frameUniforms);
+  Shader_UpdateFrameUniforms(&frameUniforms);
+
+  PROFILE_BEGIN("Sky");
+  PROFILE_GPU_BEGIN("Sky");
+  DrawSkyDome(&scene->skyDome, &scene->skyShader);
+  PROFILE_GPU_END();
+  PROFILE_END();
+
+  scene->drawStats = (ChunkDrawStats){0};
+  PROFILE_BEGIN("Chunks");
+  PROFILE_GPU_BEGIN("Chunks");
+  Uint64 drawStart = SDL_GetPerformanceCounter();
+  DrawChunks(&scene->chunkMap, &scene->cubeShader, &frustum, cam->pos,
+             VIEW_DISTANCE, &scene->drawStats);
+  scene->drawSubmitMs = (SDL_GetPerformanceCounter() - drawStart) * 1000.0 /
+                        SDL_GetPerformanceFrequency();
+  PROFILE_GPU_END();
+  PROFILE_END();
+
+  FenceChunkMeshUploads();
+}
+
+// Saves what the store should keep, then releases the world and its GL
+// objects. The context must still be current.
+void Scene_Free(Scene *scene) {
+  FreeShader(1, &scene->cubeMesh.VBO, &scene->cubeShader);
+  Shader_Destroy(&scene->skyShader);
+  Shader_FreeFrameUniforms();
+  FreeSkyDome(&scene->skyDome);
+
+  FreeAllChunks(&scene->chunkMap, scene->store);
+  ChunkWorkers_Stop(&scene->chunkWorkers);
+  if (scene->store)
+    RegionStore_Close(scene->store);
+  ChunkPool_Stop();
+  ChunkMap_Free(&scene->chunkMap);
+  FreeChunkMeshArena();
+  FreeChunkIndexBuffer();
+}
@@ -0,0 +1,43 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include "Player/Player.h"
+#include "Renderer.h"
+#include "Shaderer.h"
+#include "World/ChunkCache.h"
+#include "World/ChunkWorkers.h"
+#include "World/Lighting.h"
+#include "World/RegionStore.h"
+#include <stdbool.h>
+
+// The world and everything needed to stream and draw it, shared by the
+// windowed and headless front ends. The front end owns the GL context, input
+// and presentation; it moves the player, then calls Scene_Update and
+// Scene_Render once per frame.
+typedef struct {
+  Player player;
+  DirectionalLight sunlight;
+  VoxelMesh cubeMesh;
+  shader cubeShader;
+  shader skyShader;
+  SkyDome skyDome;
+
+  ChunkMap chunkMap;
+  RegionStore regionStore;
+  RegionStore *store;
+  ChunkWorkerPool chunkWorkers;
+  ChunkCache chunkCache;
+  ChunkView chunkView;
+  float chunkUpdateTimer;
+
+  // From the last Scene_Render; drawSubmitMs is the CPU time of DrawChunks.
+  ChunkDrawStats drawStats;
+  double drawSubmitMs;
+} Scene;
+
+bool Scene_Init(Scene *scene, int seed, const char *saveDirectory);
+void Scene_Update(Scene *scene, float deltaTime);
+void Scene_Render(Scene *scene, int width, int height);
+void Scene_Free(Scene *scene);
+
+#endif
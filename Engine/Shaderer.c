@@ -1,4 +1,5 @@
 #include "Shaderer.h"
+#include "Memory.h"
 #include <GL/glew.h>
 #include <GL/gl.h>
 #include <SDL3/SDL_error.h>
@@ -7,9 +8,12 @@
 #include <SDL3/SDL.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <SDL3_image/SDL_image.h>
 #include <GL/glu.h>
 
+static GLuint g_frameUniformBuffer = 0;
+
 static char* ReadFile(const char* path) {
     FILE* f = fopen(path, "rb");
     if (!f) {
@@ -21,7 +25,7 @@ static char* ReadFile(const char* path) {
     long size = ftell(f);
     rewind(f);
 
-    char* buffer = malloc(size + 1);
+    char* buffer = Memory_Alloc(MEM_TAG_SHADER, size + 1);
     fread(buffer, 1, size, f);
     buffer[size] = 0;
 
@@ -48,6 +52,62 @@ static GLuint Compile(GLenum type, const char* src) {
     return shader;
 }
 
+static uint32_t HashName(const char* name) {
+    uint32_t hash = 2166136261u;
+    for (; *name; name++) hash = (hash ^ (uint8_t)*name) * 16777619u;
+    return hash;
+}
+
+static void AddUniform(shader* s, const char* name, GLint location) {
+    size_t length = strlen(name) + 1;
+    char* copy = Memory_Alloc(MEM_TAG_SHADER, length);
+    if (!copy) return;
+    memcpy(copy, name, length);
+
+    uint32_t hash = HashName(name);
+    int i = hash & (s->uniformCapacity - 1);
+    while (s->uniforms[i].name) i = (i + 1) & (s->uniformCapacity - 1);
+    s->uniforms[i] = (ShaderUniform){hash, location, copy};
+}
+
+// Fills the location table from the linked program. Uniforms inside blocks
+// have no location and are skipped.
+static void LoadUniforms(shader* s) {
+    GLint count = 0, maxLength = 0;
+    glGetProgramiv(s->id, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(s->id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+    // Arrays can take two entries; keep the table at most half full.
+    int capacity = 16;
+    while (capacity < count * 4) capacity *= 2;
+    s->uniforms = Memory_Calloc(MEM_TAG_SHADER, capacity, sizeof(ShaderUniform));
+    char* name = Memory_Alloc(MEM_TAG_SHADER, maxLength + 1);
+    if (!s->uniforms || !name) {
+        Memory_Free(MEM_TAG_SHADER, s->uniforms);
+        Memory_Free(MEM_TAG_SHADER, name);
+        s->uniforms = NULL;
+        return;
+    }
+    s->uniformCapacity = capacity;
+
+    for (GLint i = 0; i < count; i++) {
+        GLint size;
+        GLenum type;
+        glGetActiveUniform(s->id, i, maxLength + 1, NULL, &size, &type, name);
+        GLint location = glGetUniformLocation(s->id, name);
+        if (location < 0) continue;
+        AddUniform(s, name, location);
+
+        // Arrays are reported as "name[0]"; answer to the bare name too.
+        size_t length = strlen(name);
+        if (length > 3 && strcmp(name + length - 3, "[0]") == 0) {
+            name[length - 3] = 0;
+            AddUniform(s, name, location);
+        }
+    }
+    Memory_Free(MEM_TAG_SHADER, name);
+}
+
 shader Shader_Load(const char* vertPath, const char* fragPath) {
     shader s = {0};
     char* vertSrc = ReadFile(vertPath);
@@ -74,13 +134,18 @@ shader Shader_Load(const char* vertPath, const char* fragPath) {
         char log[1024];
         glGetProgramInfoLog(s.id, sizeof(log), NULL, log);
         printf("Shaderer: Program link error:\n%s\n", log);
+    } else {
+        LoadUniforms(&s);
+        GLuint frameBlock = glGetUniformBlockIndex(s.id, "FrameUniforms");
+        if (frameBlock != GL_INVALID_INDEX)
+            glUniformBlockBinding(s.id, frameBlock, SHADER_FRAME_BINDING);
     }
 
     glDeleteShader(vert);
     glDeleteShader(frag);
 
-    free(vertSrc);
-    free(fragSrc);
+    Memory_Free(MEM_TAG_SHADER, vertSrc);
+    Memory_Free(MEM_TAG_SHADER, fragSrc);
 
     return s;
 }
@@ -90,26 +155,67 @@ void Shader_Destroy(shader* s) {
         glDeleteProgram(s->id);
         s->id = 0;
     }
+    for (int i = 0; i < s->uniformCapacity; i++)
+        Memory_Free(MEM_TAG_SHADER, s->uniforms[i].name);
+    Memory_Free(MEM_TAG_SHADER, s->uniforms);
+    s->uniforms = NULL;
+    s->uniformCapacity = 0;
 }
 
 void Shader_Use(shader* s) {
     glUseProgram(s->id);
 }
 
+// Returns -1, which glUniform* ignores, for names the program doesn't use.
+GLint Shader_Location(const shader* s, const char* name) {
+    if (!s->uniforms) return -1;
+
+    uint32_t hash = HashName(name);
+    int i = hash & (s->uniformCapacity - 1);
+    for (; s->uniforms[i].name; i = (i + 1) & (s->uniformCapacity - 1)) {
+        if (s->uniforms[i].hash == hash && strcmp(s->uniforms[i].name, name) == 0)
+            return s->uniforms[i].location;
+    }
+    return -1;
+}
+
 void Shader_SetInt(shader* s, const char* name, int value) {
-    GLint loc = glGetUniformLocation(s->id, name);
-    glUniform1i(loc, value);
+    glUniform1i(Shader_Location(s, name), value);
 }
 
 void Shader_SetFloat(shader* s, const char* name, float value) {
-    GLint loc = glGetUniformLocation(s->id, name);
-    glUniform1f(loc, value);
+    glUniform1f(Shader_Location(s, name), value);
 }
 
+void Shader_SetVec3(shader* s, const char* name, vec3 value) {
+    glUniform3f(Shader_Location(s, name), value.x, value.y, value.z);
+}
 
 void Shader_SetMat4(shader* s, const char* name, const mat4* mat) {
-    GLint loc = glGetUniformLocation(s->id, name);
-    glUniformMatrix4fv(loc, 1, GL_FALSE, mat->m);
+    glUniformMatrix4fv(Shader_Location(s, name), 1, GL_FALSE, mat->m);
+}
+
+bool Shader_CreateFrameUniforms(void) {
+    glGenBuffers(1, &g_frameUniformBuffer);
+    if (!g_frameUniformBuffer) return false;
+    glBindBuffer(GL_UNIFORM_BUFFER, g_frameUniformBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), NULL, GL_DYNAMIC_DRAW);
+    Memory_TrackGL(MEM_GL_BUFFER, g_frameUniformBuffer, MEM_TAG_SHADER, sizeof(FrameUniforms));
+    glBindBufferBase(GL_UNIFORM_BUFFER, SHADER_FRAME_BINDING, g_frameUniformBuffer);
+    return true;
+}
+
+void Shader_UpdateFrameUniforms(const FrameUniforms* frame) {
+    glBindBuffer(GL_UNIFORM_BUFFER, g_frameUniformBuffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameUniforms), frame);
+}
+
+void Shader_FreeFrameUniforms(void) {
+    if (g_frameUniformBuffer) {
+        Memory_UntrackGL(MEM_GL_BUFFER, g_frameUniformBuffer);
+        glDeleteBuffers(1, &g_frameUniformBuffer);
+        g_frameUniformBuffer = 0;
+    }
 }
 
 GLuint LoadTexture(const char* filename) {
@@ -139,6 +245,9 @@ GLuint LoadTexture(const char* filename) {
 
     glTexImage2D(GL_TEXTURE_2D, 0, format, surface->w, surface->h, 0, format, GL_UNSIGNED_BYTE, surface->pixels);
     glGenerateMipmap(GL_TEXTURE_2D);
+    // The mip chain adds about a third.
+    size_t bytes = (size_t)surface->w * surface->h * (bpp / 8);
+    Memory_TrackGL(MEM_GL_TEXTURE, textureID, MEM_TAG_GPU_TEXTURE, bytes + bytes / 3);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -4,16 +4,49 @@
 #include <GL/gl.h>
 #include <GL/glu.h>
 #include <SDL3/SDL_surface.h>
+#include <stdint.h>
+
+// One active uniform of a program, read once at link time. Programs keep
+// these in an open-addressed table keyed by the hash of the name, with a
+// power-of-two capacity.
+typedef struct {
+  uint32_t hash;
+  GLint location;
+  char *name;
+} ShaderUniform;
 
 typedef struct shader {
   GLuint id;
+  ShaderUniform *uniforms;
+  int uniformCapacity;
 } shader;
 
+// Per-frame values every program can read through the std140 block
+// FrameUniforms, bound at SHADER_FRAME_BINDING when the program is loaded.
+// vec3 values are padded to vec4 as std140 lays them out.
+#define SHADER_FRAME_BINDING 0
+
+typedef struct {
+  mat4 view;
+  mat4 projection;
+  vec4 viewPos;
+  vec4 lightDirection;
+  vec4 lightColor;
+  vec4 lightParams; // ambient, diffuse, specular
+  vec4 fogColor;
+  vec4 fogRange; // start, end
+} FrameUniforms;
+
 shader Shader_Load(const char *vertPath, const char *fragPath);
 void Shader_Destroy(shader *s);
 void Shader_Use(shader *s);
+GLint Shader_Location(const shader *s, const char *name);
 void Shader_SetInt(shader *s, const char *name, int value);
 void Shader_SetFloat(shader *s, const char *name, float value);
+void Shader_SetVec3(shader *s, const char *name, vec3 value);
 void Shader_SetMat4(shader *s, const char *name, const mat4 *mat);
+bool Shader_CreateFrameUniforms(void);
+void Shader_UpdateFrameUniforms(const FrameUniforms *frame);
+void Shader_FreeFrameUniforms(void);
 
 GLuint LoadTexture(const char *filename);
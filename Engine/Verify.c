@@ -0,0 +1,233 @@
+#include "Verify.h"
+#include "Memory.h"
+#include "Renderer.h"
+#include "World/Block.h"
+#include "World/ChunkWorkers.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#define VERIFY_SEED 3
+#define VERIFY_VOXEL_SIZE 0.2f
+#define VERIFY_WORKER_THREADS 4
+
+typedef struct {
+  int chunkX;
+  int chunkZ;
+  uint64_t checksum;
+} ChunkGolden;
+
+static const ChunkGolden g_chunkGoldens[] = {
+    {0, 0, 0x545cea3c389ce325ull}, {1, 0, 0x331abd5a8e317917ull},
+    {0, 1, 0x98ee1441145f4fb7ull}, {-1, -1, 0x8f00414191377087ull},
+    {5, -3, 0xad681f63385e0b25ull}, {-7, 2, 0xe7736160b6f3b0b7ull},
+    {12, 12, 0x4e9c4af202220607ull}, {-20, 9, 0xe1fbee31711451e7ull},
+    {100, -100, 0x2e42b128b71ce8e7ull}, {3, 3, 0x75a370547e7ed985ull},
+    {-2, 4, 0x972037002d4e4737ull}, {31, -17, 0xc546f06012578925ull}};
+
+// Quad totals over every section of the 5x5 chunks, indexed by ChunkMesher.
+// Each quad is four vertices and two triangles.
+static const long g_mesherGoldenQuads[2] = {84104, 41335};
+#define VERIFY_MESH_RADIUS 2
+
+#define CHUNK_GOLDEN_COUNT                                                     \
+  (int)(sizeof(g_chunkGoldens) / sizeof(g_chunkGoldens[0]))
+
+static vec3 GoldenPosition(const ChunkGolden *golden) {
+  float chunkWorldSize = CHUNK_SIZE * VERIFY_VOXEL_SIZE;
+  return (vec3){golden->chunkX * chunkWorldSize, 0.0f,
+                golden->chunkZ * chunkWorldSize};
+}
+
+static bool GenerateStandalone(int index, uint64_t *checksum) {
+  Chunk *c = CreateChunk(GoldenPosition(&g_chunkGoldens[index]), CHUNK_SIZE,
+                         VERIFY_VOXEL_SIZE);
+  if (!c)
+    return false;
+  *checksum = ChunkChecksum(c);
+  FreeChunk(c);
+  return true;
+}
+
+// Runs every chunk through the terrain, carve and decorate jobs on the
+// worker pool, a stage at a time. Decoration gets only the chunk's own
+// columns, like CreateChunk, so both routes must agree.
+static bool GenerateOnPool(uint64_t *checksums) {
+  ChunkWorkerPool pool;
+  if (!ChunkWorkers_Start(&pool, VERIFY_WORKER_THREADS, CHUNK_SIZE,
+                          VERIFY_VOXEL_SIZE, NULL))
+    return false;
+  // Left empty, so finished stages don't queue any follow-up work.
+  ChunkMap map;
+  if (!ChunkMap_Init(&map, 16)) {
+    ChunkWorkers_Stop(&pool);
+    return false;
+  }
+
+  Chunk *chunks[CHUNK_GOLDEN_COUNT] = {0};
+  bool ok = true;
+  for (int i = 0; i < CHUNK_GOLDEN_COUNT && ok; i++) {
+    chunks[i] = AllocateChunk(GoldenPosition(&g_chunkGoldens[i]),
+                              g_chunkGoldens[i].chunkX,
+                              g_chunkGoldens[i].chunkZ, VERIFY_VOXEL_SIZE);
+    ok = chunks[i] != NULL;
+  }
+
+  const ChunkState stages[] = {CHUNK_TERRAIN, CHUNK_CARVED, CHUNK_DECORATED};
+  for (int s = 0; s < 3 && ok; s++) {
+    for (int i = 0; i < CHUNK_GOLDEN_COUNT; i++) {
+      ChunkDecorationInput *in = NULL;
+      if (stages[s] == CHUNK_DECORATED) {
+        in = (ChunkDecorationInput *)Memory_Calloc(
+            MEM_TAG_VOXEL, 1, sizeof(ChunkDecorationInput));
+        if (!in) {
+          ok = false;
+          break;
+        }
+        in->present[1][1] = true;
+        memcpy(in->surfaceHeights[1][1], chunks[i]->surfaceHeights,
+               sizeof(chunks[i]->surfaceHeights));
+        memcpy(in->treeHeights[1][1], chunks[i]->treeHeights,
+               sizeof(chunks[i]->treeHeights));
+      }
+      if (!ChunkWorkers_Submit(&pool, chunks[i], stages[s], in)) {
+        Memory_Free(MEM_TAG_VOXEL, in);
+        ok = false;
+        break;
+      }
+    }
+    ChunkWorkers_Flush(&pool, &map);
+  }
+
+  for (int i = 0; i < CHUNK_GOLDEN_COUNT && ok; i++) {
+    ok = chunks[i]->state == CHUNK_DECORATED;
+    checksums[i] = ChunkChecksum(chunks[i]);
+  }
+  ChunkWorkers_Stop(&pool);
+  for (int i = 0; i < CHUNK_GOLDEN_COUNT; i++)
+    if (chunks[i])
+      FreeChunk(chunks[i]);
+  ChunkMap_Free(&map);
+  return ok;
+}
+
+bool Verify_Chunks(void) {
+  InitWorldSeed(VERIFY_SEED);
+
+  uint64_t inOrder[CHUNK_GOLDEN_COUNT];
+  uint64_t reversed[CHUNK_GOLDEN_COUNT];
+  uint64_t pooled[CHUNK_GOLDEN_COUNT];
+  for (int i = 0; i < CHUNK_GOLDEN_COUNT; i++)
+    if (!GenerateStandalone(i, &inOrder[i]))
+      return false;
+  for (int i = CHUNK_GOLDEN_COUNT - 1; i >= 0; i--)
+    if (!GenerateStandalone(i, &reversed[i]))
+      return false;
+  if (!GenerateOnPool(pooled)) {
+    printf("Verify: could not generate chunks on the worker pool\n");
+    return false;
+  }
+
+  int failures = 0;
+  for (int i = 0; i < CHUNK_GOLDEN_COUNT; i++) {
+    const ChunkGolden *golden = &g_chunkGoldens[i];
+    bool match = inOrder[i] == golden->checksum &&
+                 reversed[i] == golden->checksum &&
+                 pooled[i] == golden->checksum;
+    printf("  (%4d, %4d)  %016" PRIx64, golden->chunkX, golden->chunkZ,
+           inOrder[i]);
+    if (match)
+      printf("  ok\n");
+    else
+      printf("  MISMATCH: reverse %016" PRIx64 ", pool %016" PRIx64
+             ", golden %016" PRIx64 "\n",
+             reversed[i], pooled[i], golden->checksum);
+    failures += !match;
+  }
+  printf("Verify: %d of %d chunks match seed %d's goldens\n",
+         CHUNK_GOLDEN_COUNT - failures, CHUNK_GOLDEN_COUNT, VERIFY_SEED);
+  return failures == 0;
+}
+
+// Meshes one section with the given mesher and returns its quad count, or -1
+// if meshing failed.
+static long CountQuads(const ChunkNeighborhood *nb, ChunkMesher mesher) {
+  SetChunkMesher(mesher);
+  ChunkMeshData mesh;
+  if (!GenerateChunkMeshData(nb, CHUNK_SIZE, VERIFY_VOXEL_SIZE, &mesh))
+    return -1;
+  long quads = (long)(mesh.count / 4);
+  FreeChunkMeshData(&mesh);
+  return quads;
+}
+
+bool Verify_Meshers(void) {
+  InitWorldSeed(VERIFY_SEED);
+  ChunkMesher previous = GetChunkMesher();
+
+  // One ring more than is meshed, so the border sections see real
+  // neighbours.
+  enum { SIDE = 2 * VERIFY_MESH_RADIUS + 3 };
+  Chunk *chunks[SIDE * SIDE] = {0};
+  ChunkMap map;
+  ChunkNeighborhood *nb = (ChunkNeighborhood *)Memory_Alloc(
+      MEM_TAG_MESH_SCRATCH, sizeof(ChunkNeighborhood));
+  bool mapReady = nb && ChunkMap_Init(&map, SIDE * SIDE);
+  bool ok = mapReady;
+  float chunkWorldSize = CHUNK_SIZE * VERIFY_VOXEL_SIZE;
+  for (int i = 0; i < SIDE * SIDE && ok; i++) {
+    int x = i % SIDE - SIDE / 2, z = i / SIDE - SIDE / 2;
+    chunks[i] = CreateChunk(
+        (vec3){x * chunkWorldSize, 0.0f, z * chunkWorldSize}, CHUNK_SIZE,
+        VERIFY_VOXEL_SIZE);
+    ok = chunks[i] && ChunkMap_Insert(&map, x, z, chunks[i]);
+  }
+
+  long totals[2] = {0, 0};
+  int worse = 0;
+  for (int x = -VERIFY_MESH_RADIUS; x <= VERIFY_MESH_RADIUS && ok; x++) {
+    for (int z = -VERIFY_MESH_RADIUS; z <= VERIFY_MESH_RADIUS && ok; z++) {
+      const Chunk *c = ChunkMap_Get(&map, x, z);
+      for (int section = 0; section < CHUNK_SECTIONS && ok; section++) {
+        BuildChunkNeighborhood(&map, c, section, nb);
+        long naive = CountQuads(nb, CHUNK_MESHER_NAIVE);
+        long greedy = CountQuads(nb, CHUNK_MESHER_GREEDY);
+        ok = naive >= 0 && greedy >= 0;
+        if (greedy > naive) {
+          printf("  chunk (%d, %d) section %d: greedy %ld quads, naive %ld\n",
+                 x, z, section, greedy, naive);
+          worse++;
+        }
+        totals[CHUNK_MESHER_NAIVE] += naive;
+        totals[CHUNK_MESHER_GREEDY] += greedy;
+      }
+    }
+  }
+
+  SetChunkMesher(previous);
+  for (int i = 0; i < SIDE * SIDE; i++)
+    if (chunks[i])
+      FreeChunk(chunks[i]);
+  if (mapReady)
+    ChunkMap_Free(&map);
+  Memory_Free(MEM_TAG_MESH_SCRATCH, nb);
+  if (!ok) {
+    printf("Verify: could not mesh the test chunks\n");
+    return false;
+  }
+
+  const char *names[2] = {"naive", "greedy"};
+  int failures = worse;
+  for (int m = 0; m < 2; m++) {
+    bool match = totals[m] == g_mesherGoldenQuads[m];
+    printf("  %-6s %8ld quads, %8ld vertices, %8ld triangles  %s\n",
+           names[m], totals[m], totals[m] * 4, totals[m] * 2,
+           match ? "ok" : "MISMATCH");
+    if (!match)
+      printf("         recorded %ld quads\n", g_mesherGoldenQuads[m]);
+    failures += !match;
+  }
+  printf("Verify: %s\n", failures == 0 ? "mesh counts match"
+                                        : "mesh counts differ");
+  return failures == 0;
+}
@@ -0,0 +1,20 @@
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#include <stdbool.h>
+
+// Self-checks run from the command line, without a GL context. Each prints
+// what it compared and returns false on any mismatch.
+
+// Generates a fixed set of chunks for seed 3 in order, in reverse and on the
+// worker pool, and compares every checksum with the golden table. The
+// goldens change whenever world generation does; update them in the same
+// commit.
+bool Verify_Chunks(void);
+
+// Meshes every section of the 5x5 chunks around the origin for seed 3 with
+// both meshers, checks the totals against the recorded counts and that
+// greedy meshing never emits more quads than naive meshing.
+bool Verify_Meshers(void);
+
+#endif
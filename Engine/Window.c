@@ -1,13 +1,15 @@
 #include "Window.h"
 #include "Camera.h"
+#include "Memory.h"
 #include <GL/glew.h>
 #include "Player/Player.h"
+#include "Profiler.h"
 #include "Renderer.h"
+#include "Scene.h"
 #include "Shaderer.h"
 #include "World/Block.h"
-#include "World/Lighting.h"
+#include "World/ChunkWorkers.h"
 #include "ui/text.h"
-#include "utils/FreeUtil.h"
 #include "utils/MathUtil.h"
 #include <SDL3/SDL.h>
 #include <SDL3/SDL_error.h>
@@ -15,10 +17,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-#define CHUNK_SIZE 32
-#define VIEW_DISTANCE 100.0f
-#define RENDER_DISTANCE 5
-#define MAX_CHUNKS 64
+#define SAVE_DIRECTORY "saves"
+#define PROFILE_TRACE_FILE "profile.json"
 
 int CreateWindow(const char *title, int WIDTH, int HEIGHT) {
   window_t Window = {0};
@@ -73,39 +73,19 @@ int CreateWindow(const char *title, int WIDTH, int HEIGHT) {
     return 1;
   }
 
-  glEnable(GL_BLEND);
-  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-  glEnable(GL_DEPTH_TEST);
-  glEnable(GL_MULTISAMPLE);
-
   SDL_SetWindowRelativeMouseMode(Window.window, true);
+  PROFILE_THREAD("Main");
 
-  InitWorldSeed(rand() % 6);
-
-  Player player;
-  InitPlayer(&player,
-             (vec3){CHUNK_SIZE * 0.2f * 0.5f, 25.0f, CHUNK_SIZE * 0.2f * 0.5f});
-
-  DirectionalLight sunlight = {.direction = {-0.2f, -1.0f, -0.4f},
-                               .color = {1.0f, 0.98f, 0.95f},
-                               .ambient = 0.4f,
-                               .diffuse = 0.6f,
-                               .specular = 0.2f};
-
-  VoxelMesh cubeMesh = CreateVoxelMesh(0.2f);
-  shader cubeShader =
-      Shader_Load("Shaders/voxel/cube.vert", "Shaders/voxel/cube.frag");
-
-  ChunkSlot *chunkSlots = (ChunkSlot *)calloc(MAX_CHUNKS, sizeof(ChunkSlot));
-  Chunk **chunkPointers = (Chunk **)malloc(MAX_CHUNKS * sizeof(Chunk *));
-
-  UpdateChunkLoading(chunkSlots, MAX_CHUNKS, player.position, 0.2f, CHUNK_SIZE,
-                     RENDER_DISTANCE);
-
-  shader skyShader =
-      Shader_Load("Shaders/skybox/sky.vert", "Shaders/skybox/sky.frag");
-  SkyDome skyDome = CreateSkyDome(64, 32, (vec3){0.5f, 0.7f, 0.95f},
-                                  (vec3){0.9f, 0.95f, 1.0f});
+  Scene scene;
+  if (!Scene_Init(&scene, rand() % 6, SAVE_DIRECTORY)) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Scene init failed\n");
+    SDL_GL_DestroyContext(Window.context);
+    SDL_DestroyWindow(Window.window);
+    TTF_Quit();
+    SDL_Quit();
+    return 1;
+  }
+  Player *player = &scene.player;
 
   shader fontShader =
       Shader_Load("Shaders/Text/text.vert", "Shaders/Text/text.frag");
@@ -117,12 +97,24 @@ int CreateWindow(const char *title, int WIDTH, int HEIGHT) {
   SDL_Color yellow = {255, 255, 0, 255};
   TextTexture fpsTex = {0};
   TextTexture posTex = {0};
+  TextTexture cullTex = {0};
+  TextTexture arenaTex = {0};
+  TextTexture memTex = {0};
+#if PROFILER_ENABLED
+  // One line per track: main thread, chunk workers, GPU.
+  TextTexture profileTex[3] = {0};
+  const char *profileLabels[3] = {"CPU", "Workers", "GPU"};
+  char profileText[320];
+#endif
 
   char fpsText[32];
   char posText[64];
+  char cullText[128];
+  char arenaText[96];
+  char memText[256];
   int frames = 0;
   float fpsTimer = 0.0f;
-  float chunkUpdateTimer = 0.0f;
+  double drawSubmitMs = 0.0;
 
   snprintf(fpsText, sizeof(fpsText), "FPS: 0");
   fpsTex = CreateTextTexture(font, fpsText, yellow);
@@ -130,17 +122,45 @@ int CreateWindow(const char *title, int WIDTH, int HEIGHT) {
   snprintf(posText, sizeof(posText), "Pos: (0.0, 0.0, 0.0)");
   posTex = CreateTextTexture(font, posText, yellow);
 
+  snprintf(cullText, sizeof(cullText), "Chunks: 0/0  Tris: 0/0");
+  cullTex = CreateTextTexture(font, cullText, yellow);
+
+  snprintf(arenaText, sizeof(arenaText), "Arena: 0.0/0.0 MiB");
+  arenaTex = CreateTextTexture(font, arenaText, yellow);
+
+  snprintf(memText, sizeof(memText), "Mem MiB: ");
+  memTex = CreateTextTexture(font, memText, yellow);
+
   Window.Running = true;
   int lastTicks = SDL_GetTicks();
 
   while (Window.Running) {
+    PROFILE_BEGIN("Frame");
+    PROFILE_BEGIN("Input");
     SDL_Event event;
     while (SDL_PollEvent(&event)) {
       if (event.type == SDL_EVENT_QUIT)
         Window.Running = false;
       if (event.type == SDL_EVENT_MOUSE_MOTION)
-        ProcessPlayerMouseMovement(&player, event.motion.xrel,
+        ProcessPlayerMouseMovement(player, event.motion.xrel,
                                    event.motion.yrel);
+      if (event.type == SDL_EVENT_KEY_DOWN && !event.key.repeat &&
+          event.key.scancode == SDL_SCANCODE_G) {
+        SetChunkMesher(GetChunkMesher() == CHUNK_MESHER_GREEDY
+                           ? CHUNK_MESHER_NAIVE
+                           : CHUNK_MESHER_GREEDY);
+        RemeshLoadedChunks(&scene.chunkMap, &scene.chunkWorkers);
+      }
+      if (event.type == SDL_EVENT_KEY_DOWN && !event.key.repeat &&
+          event.key.scancode == SDL_SCANCODE_M) {
+        SetChunkMultiDraw(!GetChunkMultiDraw());
+      }
+#if PROFILER_ENABLED
+      if (event.type == SDL_EVENT_KEY_DOWN && !event.key.repeat &&
+          event.key.scancode == SDL_SCANCODE_P) {
+        Profiler_WriteTrace(PROFILE_TRACE_FILE);
+      }
+#endif
       if (event.type == SDL_EVENT_WINDOW_RESIZED) {
         WIDTH = event.window.data1;
         HEIGHT = event.window.data2;
@@ -152,68 +172,72 @@ int CreateWindow(const char *title, int WIDTH, int HEIGHT) {
     float deltaTime = (nowTicks - lastTicks) / 1000.0f;
     lastTicks = nowTicks;
 
-    ProcessPlayerInput(&player, deltaTime);
-
-    int activeChunks = 0;
-    for (int i = 0; i < MAX_CHUNKS; i++) {
-      if (chunkSlots[i].loaded) {
-        chunkPointers[activeChunks++] = chunkSlots[i].chunk;
-      }
-    }
+    ProcessPlayerInput(player, deltaTime);
+    PROFILE_END();
 
-    UpdatePlayer(&player, deltaTime, chunkPointers, activeChunks, CHUNK_SIZE,
-                 0.2f);
+    PROFILE_BEGIN("Player");
+    UpdatePlayer(player, deltaTime, &scene.chunkMap, CHUNK_SIZE, 0.2f);
+    PROFILE_END();
 
-    chunkUpdateTimer += deltaTime;
-    if (chunkUpdateTimer >= 0.5f) {
-      UpdateChunkLoading(chunkSlots, MAX_CHUNKS, player.position, 0.2f,
-                         CHUNK_SIZE, RENDER_DISTANCE);
-      chunkUpdateTimer = 0.0f;
-    }
+    Scene_Update(&scene, deltaTime);
 
     frames++;
     fpsTimer += deltaTime;
     if (fpsTimer >= 0.5f) {
+      PROFILE_SCOPE("Overlay");
       snprintf(fpsText, sizeof(fpsText), "FPS: %d", (int)(frames / fpsTimer));
-      frames = 0;
-      fpsTimer = 0.0f;
 
       FreeTextTexture(&fpsTex);
       fpsTex = CreateTextTexture(font, fpsText, yellow);
 
       snprintf(posText, sizeof(posText), "Pos: (%.1f, %.1f, %.1f)",
-               player.position.x, player.position.y, player.position.z);
+               player->position.x, player->position.y, player->position.z);
       FreeTextTexture(&posTex);
       posTex = CreateTextTexture(font, posText, yellow);
-    }
 
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-    float aspect = (float)WIDTH / HEIGHT;
-    mat4 projection = Perspective(60.0f, aspect, 0.1f, 200.0f);
-    vec3 front = CameraFront(&player.cam);
-    vec3 target = Vec3Add(player.cam.pos, front);
-    vec3 up = {0.0f, 1.0f, 0.0f};
-    mat4 view = LookAt(player.cam.pos, target, up);
-
-    Shader_Use(&skyShader);
-    glUniform3f(glGetUniformLocation(skyShader.id, "topColor"), 0.53f, 0.81f,
-                0.98f);
-    glUniform3f(glGetUniformLocation(skyShader.id, "horizonColor"), 1.0f, 1.0f,
-                1.0f);
-    DrawSkyDome(&skyDome, &skyShader, view, projection);
-
-    Shader_Use(&cubeShader);
-    SetDirectionalLightUniforms(&sunlight, cubeShader.id, player.cam.pos);
-
-    for (int i = 0; i < MAX_CHUNKS; i++) {
-      if (chunkSlots[i].loaded && chunkSlots[i].chunk) {
-        DrawChunk(chunkSlots[i].chunk, &cubeMesh, &cubeShader, view, projection,
-                  CHUNK_SIZE, player.cam.pos, VIEW_DISTANCE);
+      snprintf(cullText, sizeof(cullText),
+               "Chunks: %d/%d  Tris: %ld/%ld  Submit: %.2f ms (%s)",
+               scene.drawStats.drawnChunks, scene.drawStats.culledChunks,
+               scene.drawStats.drawnTriangles, scene.drawStats.culledTriangles,
+               drawSubmitMs / frames,
+               GetChunkMultiDraw() ? "indirect" : "per section");
+      FreeTextTexture(&cullTex);
+      cullTex = CreateTextTexture(font, cullText, yellow);
+      frames = 0;
+      fpsTimer = 0.0f;
+      drawSubmitMs = 0.0;
+
+      MeshArenaStats arena = GetChunkMeshArenaStats();
+      snprintf(arenaText, sizeof(arenaText),
+               "Arena: %.1f/%.1f MiB  Free blocks: %d  Frag: %d%%%s",
+               arena.used / 1048576.0, arena.capacity / 1048576.0,
+               arena.freeBlocks, (int)(arena.fragmentation * 100.0f),
+               arena.staged ? "" : "  (no staging)");
+      FreeTextTexture(&arenaTex);
+      arenaTex = CreateTextTexture(font, arenaText, yellow);
+
+      int memLength = snprintf(memText, sizeof(memText), "Mem MiB: ");
+      Memory_FormatOverlay(memText + memLength, sizeof(memText) - memLength);
+      FreeTextTexture(&memTex);
+      memTex = CreateTextTexture(font, memText, yellow);
+
+#if PROFILER_ENABLED
+      for (int i = 0; i < 3; i++) {
+        int n = snprintf(profileText, sizeof(profileText), "%s ms: ",
+                         profileLabels[i]);
+        Profiler_FormatOverlay((ProfilerTrack)i, profileText + n,
+                               sizeof(profileText) - n);
+        FreeTextTexture(&profileTex[i]);
+        profileTex[i] = CreateTextTexture(font, profileText, yellow);
       }
+#endif
     }
 
+    Scene_Render(&scene, WIDTH, HEIGHT);
+    drawSubmitMs += scene.drawSubmitMs;
+
+    PROFILE_BEGIN("Text");
+    PROFILE_GPU_BEGIN("Text");
     glDisable(GL_DEPTH_TEST);
     if (fpsTex.texture != 0) {
       RenderTextTexture(&fontShader, &fpsTex, 10.0f, 10.0f, WIDTH, HEIGHT);
@@ -221,22 +245,53 @@ int CreateWindow(const char *title, int WIDTH, int HEIGHT) {
     if (posTex.texture != 0) {
       RenderTextTexture(&fontShader, &posTex, 10.0f, 40.0f, WIDTH, HEIGHT);
     }
+    if (cullTex.texture != 0) {
+      RenderTextTexture(&fontShader, &cullTex, 10.0f, 70.0f, WIDTH, HEIGHT);
+    }
+    if (arenaTex.texture != 0) {
+      RenderTextTexture(&fontShader, &arenaTex, 10.0f, 100.0f, WIDTH, HEIGHT);
+    }
+    if (memTex.texture != 0) {
+      RenderTextTexture(&fontShader, &memTex, 10.0f, 130.0f, WIDTH, HEIGHT);
+    }
+#if PROFILER_ENABLED
+    for (int i = 0; i < 3; i++) {
+      if (profileTex[i].texture != 0) {
+        RenderTextTexture(&fontShader, &profileTex[i], 10.0f, 160.0f + 30.0f * i,
+                          WIDTH, HEIGHT);
+      }
+    }
+#endif
     glEnable(GL_DEPTH_TEST);
+    PROFILE_GPU_END();
+    PROFILE_END();
 
+    PROFILE_BEGIN("Swap");
     SDL_GL_SwapWindow(Window.window);
+    PROFILE_END();
+    PROFILE_END();
+    PROFILE_FRAME_END();
   }
 
-  FreeShader(1, &cubeMesh.VBO, &cubeShader);
-  FreeSkyDome(&skyDome);
+  Shader_Destroy(&fontShader);
   FreeTextTexture(&fpsTex);
   FreeTextTexture(&posTex);
+  FreeTextTexture(&cullTex);
+  FreeTextTexture(&arenaTex);
+  FreeTextTexture(&memTex);
+#if PROFILER_ENABLED
+  for (int i = 0; i < 3; i++)
+    FreeTextTexture(&profileTex[i]);
+#endif
   if (font)
     TTF_CloseFont(font);
   TTF_Quit();
 
-  FreeAllChunks(chunkSlots, MAX_CHUNKS, CHUNK_SIZE);
-  free(chunkSlots);
-  free(chunkPointers);
+  Scene_Free(&scene);
+#if PROFILER_ENABLED
+  Profiler_WriteTrace(PROFILE_TRACE_FILE);
+  Profiler_Shutdown();
+#endif
 
   SDL_GL_DestroyContext(Window.context);
   SDL_DestroyWindow(Window.window);
@@ -1,89 +1,14 @@
 #include "Block.h"
+#include "ChunkWorkers.h"
+#include "ChunkCache.h"
+#include "ChunkPool.h"
+#include "RegionStore.h"
+#include "Noise.h"
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <time.h>
 
-static int hash(int x, int y, int seed) {
-    int h = seed;
-    h = (h ^ x) * 0x27d4eb2d;
-    h = (h ^ y) * 0x27d4eb2d;
-    h = (h ^ (h >> 15)) * 0x27d4eb2d;
-    return h;
-}
-
-static float smoothstep(float t) {
-    return t * t * (3.0f - 2.0f * t);
-}
-
-static float lerp(float a, float b, float t) {
-    return a + t * (b - a);
-}
-
-static float gradient(int hash, float x, float y) {
-    int h = hash & 7;
-    float u = h < 4 ? x : y;
-    float v = h < 4 ? y : x;
-    return ((h & 1) ? -u : u) + ((h & 2) ? -v : v);
-}
-
-float perlinNoise2D(float x, float y, int seed) {
-    int x0 = (int)floorf(x);
-    int y0 = (int)floorf(y);
-    int x1 = x0 + 1;
-    int y1 = y0 + 1;
-
-    float sx = x - (float)x0;
-    float sy = y - (float)y0;
-
-    float n00 = gradient(hash(x0, y0, seed), sx, sy);
-    float n10 = gradient(hash(x1, y0, seed), sx - 1.0f, sy);
-    float n01 = gradient(hash(x0, y1, seed), sx, sy - 1.0f);
-    float n11 = gradient(hash(x1, y1, seed), sx - 1.0f, sy - 1.0f);
-
-    float u = smoothstep(sx);
-    float v = smoothstep(sy);
-
-    float nx0 = lerp(n00, n10, u);
-    float nx1 = lerp(n01, n11, u);
-
-    return lerp(nx0, nx1, v);
-}
-
-float perlinNoise(float x, float z, int seed, int octaves, float persistence) {
-    float total = 0.0f;
-    float frequency = 1.0f;
-    float amplitude = 1.0f;
-    float maxValue = 0.0f;
-
-    for (int i = 0; i < octaves; i++) {
-        total += perlinNoise2D(x * frequency, z * frequency, seed + i) * amplitude;
-
-        maxValue += amplitude;
-        amplitude *= persistence;
-        frequency *= 2.0f;
-    }
-
-    return total / maxValue;
-}
-
-float noise2D(int x, int z, int seed) {
-    int n = x + z * 57 + seed * 131;
-    n = (n << 13) ^ n;
-    return (1.0f - ((n * (n * n * 15731 + 789221) + 1376312589) & 0x7fffffff) / 1073741824.0f);
-}
-
-float caveNoise(float x, float y, float z, int seed) {
-    int ix = (int)x;
-    int iy = (int)y;
-    int iz = (int)z;
-
-    int n = ix + iy * 57 + iz * 131 + seed * 263;
-    n = (n << 13) ^ n;
-    float noise = (1.0f - ((n * (n * n * 15731 + 789221) + 1376312589) & 0x7fffffff) / 1073741824.0f);
-
-    return noise;
-}
-
 block_type getBlockType(int worldY, int surfaceHeight, float temperature) {
     if (worldY > surfaceHeight) return BLOCK_GRASS;
 
@@ -117,31 +42,85 @@ int GetWorldSeed() {
     return g_worldSeed;
 }
 
-Chunk* CreateChunk(vec3 pos, int size, float voxelSize) {
-    int worldSeed = GetWorldSeed();
-
-    Chunk* c = (Chunk*)malloc(sizeof(Chunk));
+Chunk* AllocateChunk(vec3 pos, int chunkX, int chunkZ, float voxelSize) {
+    Chunk* c = ChunkPool_Acquire();
     if (!c) return NULL;
 
+    for (int i = 0; i < CHUNK_SECTIONS; i++) {
+        BlockStorage_Init(&c->sections[i].blocks, BLOCK_AIR);
+        c->sections[i].origin = (vec3){pos.x, pos.y + i * CHUNK_SIZE * voxelSize, pos.z};
+    }
     c->position = pos;
-    c->meshVAO = 0;
-    c->meshVBO = 0;
-    c->meshVertexCount = 0;
+    c->chunkX = chunkX;
+    c->chunkZ = chunkZ;
+    c->state = CHUNK_EMPTY;
+    return c;
+}
+
+// Builds a standalone chunk synchronously. Without neighbours, trees near the
+// border are clipped.
+Chunk* CreateChunk(vec3 pos, int size, float voxelSize) {
+    float chunkWorldSize = size * voxelSize;
+    Chunk* c = AllocateChunk(pos, (int)floorf(pos.x / chunkWorldSize), (int)floorf(pos.z / chunkWorldSize), voxelSize);
+    if (!c) return NULL;
+
+    GenerateChunkTerrain(c, size, voxelSize);
+    CarveChunk(c, size, voxelSize);
+
+    ChunkDecorationInput* in = (ChunkDecorationInput*)Memory_Calloc(MEM_TAG_VOXEL, 1, sizeof(ChunkDecorationInput));
+    if (in) {
+        in->present[1][1] = true;
+        memcpy(in->surfaceHeights[1][1], c->surfaceHeights, sizeof(c->surfaceHeights));
+        memcpy(in->treeHeights[1][1], c->treeHeights, sizeof(c->treeHeights));
+        DecorateChunk(c, in, size);
+        Memory_Free(MEM_TAG_VOXEL, in);
+    }
+    c->state = CHUNK_DECORATED;
+    return c;
+}
 
-    for (int x = 0; x < size; x++)
-        for (int y = 0; y < size; y++)
-            for (int z = 0; z < size; z++)
-                c->blocks[x][y][z] = NULL;
+// Trees only grow on surfaces below this height.
+#define TREE_LINE 22
+
+#define CAVE_CELL 4
+#define CAVE_LATTICE (CHUNK_SIZE / CAVE_CELL + 1)
+#define CAVE_WIDTH 0.065f
+
+// Fills the column heights and base terrain, and decides which columns grow a
+// tree. Everything here depends only on the chunk's own columns.
+void GenerateChunkTerrain(Chunk* c, int size, float voxelSize) {
+    int worldSeed = GetWorldSeed();
+    vec3 pos = c->position;
+
+    // Column noise is evaluated for the whole grid up front so the batch
+    // kernels can vectorise across columns.
+    float columnX[CHUNK_SIZE * CHUNK_SIZE], columnZ[CHUNK_SIZE * CHUNK_SIZE];
+    float continentalNoise[CHUNK_SIZE * CHUNK_SIZE], mountainNoise[CHUNK_SIZE * CHUNK_SIZE];
+    float hillNoise[CHUNK_SIZE * CHUNK_SIZE], detailNoise[CHUNK_SIZE * CHUNK_SIZE];
+    float temperatureNoise[CHUNK_SIZE * CHUNK_SIZE];
+    int columns = size * size;
+
+    for (int x = 0; x < size; x++) {
+        for (int z = 0; z < size; z++) {
+            columnX[x * size + z] = (pos.x / voxelSize) + x;
+            columnZ[x * size + z] = (pos.z / voxelSize) + z;
+        }
+    }
+    Noise_PerlinBatch(columnX, columnZ, columns, 0.0008f, worldSeed, 4, 0.5f, continentalNoise);
+    Noise_PerlinBatch(columnX, columnZ, columns, 0.003f, worldSeed + 1, 6, 0.55f, mountainNoise);
+    Noise_PerlinBatch(columnX, columnZ, columns, 0.01f, worldSeed + 2, 4, 0.5f, hillNoise);
+    Noise_PerlinBatch(columnX, columnZ, columns, 0.04f, worldSeed + 3, 3, 0.4f, detailNoise);
+    Noise_PerlinBatch(columnX, columnZ, columns, 0.003f, worldSeed + 100, 2, 0.5f, temperatureNoise);
 
+    int minSurfaceHeight = WORLD_HEIGHT, maxSurfaceHeight = 0;
     for (int x = 0; x < size; x++) {
         for (int z = 0; z < size; z++) {
-            float worldX = (pos.x / voxelSize) + x;
-            float worldZ = (pos.z / voxelSize) + z;
+            int column = x * size + z;
 
-            float continentalShape = perlinNoise(worldX * 0.0008f, worldZ * 0.0008f, worldSeed, 4, 0.5f);
-            float mountains = perlinNoise(worldX * 0.003f, worldZ * 0.003f, worldSeed + 1, 6, 0.55f);
-            float hills = perlinNoise(worldX * 0.01f, worldZ * 0.01f, worldSeed + 2, 4, 0.5f);
-            float details = perlinNoise(worldX * 0.04f, worldZ * 0.04f, worldSeed + 3, 3, 0.4f);
+            float continentalShape = continentalNoise[column];
+            float mountains = mountainNoise[column];
+            float hills = hillNoise[column];
+            float details = detailNoise[column];
 
             float baseHeight = continentalShape * 0.3f + mountains * 0.4f + hills * 0.2f + details * 0.1f;
 
@@ -152,52 +131,143 @@ Chunk* CreateChunk(vec3 pos, int size, float voxelSize) {
 
             int surfaceHeight = (int)((baseHeight + 1.0f) * 0.5f * 35.0f * heightMultiplier + 8.0f);
 
-            surfaceHeight = fmaxf(3, fminf(size - 1, surfaceHeight));
+            surfaceHeight = fmaxf(3, fminf(WORLD_HEIGHT - 1, surfaceHeight));
+            float temperature = temperatureNoise[column];
+
+            // Caves stay more than three blocks below the surface, so the
+            // surface block decided here is final.
+            int treeHeight = 0;
+            if (getBlockType(surfaceHeight, surfaceHeight, temperature) == BLOCK_GRASS &&
+                surfaceHeight < TREE_LINE && surfaceHeight > 5) {
+
+                int blockX = c->chunkX * size + x;
+                int blockZ = c->chunkZ * size + z;
+                float treeChance = Noise_RandomUnit(worldSeed, blockX, surfaceHeight, blockZ, NOISE_PURPOSE_TREE);
+                if (treeChance < 0.05f && temperature > -0.2f) {
+                    treeHeight = 4 + Noise_Random(worldSeed, blockX, surfaceHeight, blockZ, NOISE_PURPOSE_TREE_HEIGHT) % 3;
+                }
+            }
+            c->surfaceHeights[column] = (uint16_t)surfaceHeight;
+            c->treeHeights[column] = (uint8_t)treeHeight;
+            if (surfaceHeight < minSurfaceHeight) minSurfaceHeight = surfaceHeight;
+            if (surfaceHeight > maxSurfaceHeight) maxSurfaceHeight = surfaceHeight;
+        }
+    }
+
+    // Sections entirely above the terrain stay uniform air, and sections at
+    // least four blocks under every column are uniform stone; only the ones
+    // the surface passes through are filled voxel by voxel.
+    for (int i = 0; i < CHUNK_SECTIONS; i++) {
+        int base = i * CHUNK_SIZE;
+        if (base > maxSurfaceHeight) break;
+        if (base + CHUNK_SIZE - 1 <= minSurfaceHeight - 4) {
+            BlockStorage_Init(&c->sections[i].blocks, BLOCK_STONE);
+            continue;
+        }
+
+        for (int x = 0; x < size; x++) {
+            for (int z = 0; z < size; z++) {
+                int column = x * size + z;
+                int top = c->surfaceHeights[column];
+                if (top > base + CHUNK_SIZE - 1) top = base + CHUNK_SIZE - 1;
+                for (int y = base; y <= top; y++) {
+                    SetChunkBlock(c, x, y, z, getBlockType(y, c->surfaceHeights[column], temperatureNoise[column]));
+                }
+            }
+        }
+    }
+}
+
+// Caves follow the zero sheets of two 3D gradient-noise fields: a voxel is
+// carved where both are near zero, which traces continuous tunnels. The
+// fields are sampled every CAVE_CELL voxels and interpolated per layer.
+void CarveChunk(Chunk* c, int size, float voxelSize) {
+    int worldSeed = GetWorldSeed();
+
+    int maxSurfaceHeight = 0;
+    for (int i = 0; i < size * size; i++)
+        if (c->surfaceHeights[i] > maxSurfaceHeight) maxSurfaceHeight = c->surfaceHeights[i];
+
+    float caveLattice1[CAVE_LATTICE * CAVE_LATTICE * CAVE_LATTICE];
+    float caveLattice2[CAVE_LATTICE * CAVE_LATTICE * CAVE_LATTICE];
+    float caveLayer1[CHUNK_SIZE * CHUNK_SIZE], caveLayer2[CHUNK_SIZE * CHUNK_SIZE];
 
-            float temperature = perlinNoise(worldX * 0.003f, worldZ * 0.003f, worldSeed + 100, 2, 0.5f);
+    for (int i = 0; i < CHUNK_SECTIONS; i++) {
+        int base = i * CHUNK_SIZE;
+        if (base >= maxSurfaceHeight - 3) break;
 
-            for (int y = 0; y <= surfaceHeight; y++) {
-                float worldY = (pos.y / voxelSize) + y;
+        vec3 origin = c->sections[i].origin;
+        float originX = origin.x / voxelSize, originY = origin.y / voxelSize, originZ = origin.z / voxelSize;
+        Noise_Perlin3DLattice(originX, originY, originZ, CAVE_CELL, CAVE_LATTICE, CAVE_LATTICE, CAVE_LATTICE,
+                              0.03f, worldSeed + 50, caveLattice1);
+        Noise_Perlin3DLattice(originX, originY, originZ, CAVE_CELL, CAVE_LATTICE, CAVE_LATTICE, CAVE_LATTICE,
+                              0.04f, worldSeed + 75, caveLattice2);
 
-                float cave1 = caveNoise(worldX * 0.05f, worldY * 0.05f, worldZ * 0.05f, worldSeed + 50);
-                float cave2 = caveNoise(worldX * 0.04f, worldY * 0.04f, worldZ * 0.04f, worldSeed + 75);
+        for (int y = 0; y < CHUNK_SIZE && base + y < maxSurfaceHeight - 3; y++) {
+            Noise_LatticeLayer(caveLattice1, CAVE_LATTICE, CAVE_LATTICE, CAVE_CELL, y, caveLayer1);
+            Noise_LatticeLayer(caveLattice2, CAVE_LATTICE, CAVE_LATTICE, CAVE_CELL, y, caveLayer2);
 
-                bool isCave = (cave1 > 0.65f && cave2 > 0.6f && y < surfaceHeight - 3);
+            for (int x = 0; x < size; x++) {
+                for (int z = 0; z < size; z++) {
+                    if (base + y >= c->surfaceHeights[x * size + z] - 3) continue;
 
-                if (!isCave) {
-                    block_type type = getBlockType(y, surfaceHeight, temperature);
-                    vec3 blockPos = {
-                        pos.x + x * voxelSize,
-                        pos.y + y * voxelSize,
-                        pos.z + z * voxelSize
-                    };
-                    c->blocks[x][y][z] = CreateBlock(blockPos, type);
+                    float cave1 = caveLayer1[z * size + x];
+                    float cave2 = caveLayer2[z * size + x];
+
+                    if (fabsf(cave1) < CAVE_WIDTH && fabsf(cave2) < CAVE_WIDTH) {
+                        SetChunkBlock(c, x, base + y, z, BLOCK_AIR);
+                    }
                 }
             }
+        }
+    }
+}
+
+void BuildChunkDecorationInput(const ChunkMap* map, const Chunk* c, ChunkDecorationInput* out) {
+    for (int dx = -1; dx <= 1; dx++) {
+        for (int dz = -1; dz <= 1; dz++) {
+            const Chunk* n = (dx == 0 && dz == 0) ? c : ChunkMap_Get(map, c->chunkX + dx, c->chunkZ + dz);
+            bool present = n && n->state >= CHUNK_TERRAIN;
+            out->present[dx + 1][dz + 1] = present;
+            if (!present) continue;
+            memcpy(out->surfaceHeights[dx + 1][dz + 1], n->surfaceHeights, sizeof(n->surfaceHeights));
+            memcpy(out->treeHeights[dx + 1][dz + 1], n->treeHeights, sizeof(n->treeHeights));
+        }
+    }
+}
 
-            if (c->blocks[x][surfaceHeight][z] &&
-                c->blocks[x][surfaceHeight][z]->type == BLOCK_GRASS &&
-                surfaceHeight < size - 10 && surfaceHeight > 5) {
-
-                float treeNoise = noise2D((int)worldX, (int)worldZ, worldSeed + 200);
-                if (treeNoise > 0.90f && temperature > -0.2f) {
-                    int treeHeight = 4 + (rand() % 3);
-
-                    for (int ty = 1; ty <= treeHeight && (surfaceHeight + ty) < size; ty++) {
-                        if (!c->blocks[x][surfaceHeight + ty][z]) {
-                            vec3 blockPos = {
-                                pos.x + x * voxelSize,
-                                pos.y + (surfaceHeight + ty) * voxelSize,
-                                pos.z + z * voxelSize
-                            };
-                            c->blocks[x][surfaceHeight + ty][z] = CreateBlock(blockPos, BLOCK_WOOD);
+// Places every tree of the 3x3 neighbourhood that reaches into c, clipped to
+// c. Each chunk only ever writes its own blocks, and sources are visited in a
+// fixed order, so the result doesn't depend on which neighbour loaded first.
+void DecorateChunk(Chunk* c, const ChunkDecorationInput* in, int size) {
+    for (int dx = -1; dx <= 1; dx++) {
+        for (int dz = -1; dz <= 1; dz++) {
+            if (!in->present[dx + 1][dz + 1]) continue;
+            const uint16_t* heights = in->surfaceHeights[dx + 1][dz + 1];
+            const uint8_t* trees = in->treeHeights[dx + 1][dz + 1];
+
+            for (int sx = 0; sx < size; sx++) {
+                for (int sz = 0; sz < size; sz++) {
+                    int treeHeight = trees[sx * size + sz];
+                    if (!treeHeight) continue;
+
+                    int x = sx + dx * size;
+                    int z = sz + dz * size;
+                    if (x < -2 || x > size + 1 || z < -2 || z > size + 1) continue;
+                    int surfaceHeight = heights[sx * size + sz];
+
+                    if (x >= 0 && x < size && z >= 0 && z < size) {
+                        for (int ty = 1; ty <= treeHeight && (surfaceHeight + ty) < WORLD_HEIGHT; ty++) {
+                            if (GetChunkBlock(c, x, surfaceHeight + ty, z) == BLOCK_AIR) {
+                                SetChunkBlock(c, x, surfaceHeight + ty, z, BLOCK_WOOD);
+                            }
                         }
                     }
 
                     int leafStartY = surfaceHeight + treeHeight - 1;
                     for (int ly = 0; ly <= 2; ly++) {
                         int currentY = leafStartY + ly;
-                        if (currentY >= size) break;
+                        if (currentY >= WORLD_HEIGHT) break;
 
                         int radius = (ly == 1) ? 2 : 1;
                         for (int lx = -radius; lx <= radius; lx++) {
@@ -208,13 +278,8 @@ Chunk* CreateChunk(vec3 pos, int size, float voxelSize) {
                                 int leafZ = z + lz;
 
                                 if (leafX >= 0 && leafX < size && leafZ >= 0 && leafZ < size) {
-                                    if (!c->blocks[leafX][currentY][leafZ]) {
-                                        vec3 blockPos = {
-                                            pos.x + leafX * voxelSize,
-                                            pos.y + currentY * voxelSize,
-                                            pos.z + leafZ * voxelSize
-                                        };
-                                        c->blocks[leafX][currentY][leafZ] = CreateBlock(blockPos, BLOCK_GRASS);
+                                    if (GetChunkBlock(c, leafX, currentY, leafZ) == BLOCK_AIR) {
+                                        SetChunkBlock(c, leafX, currentY, leafZ, BLOCK_GRASS);
                                     }
                                 }
                             }
@@ -224,68 +289,386 @@ Chunk* CreateChunk(vec3 pos, int size, float voxelSize) {
             }
         }
     }
+}
 
-    return c;
+void FreeChunk(Chunk* c) {
+    ChunkPool_Release(c);
+}
+
+// y is the height within the column, 0 to WORLD_HEIGHT - 1.
+block_type GetChunkBlock(const Chunk* c, int x, int y, int z) {
+    if (x < 0 || x >= CHUNK_SIZE || y < 0 || y >= WORLD_HEIGHT || z < 0 || z >= CHUNK_SIZE)
+        return BLOCK_AIR;
+    return (block_type)BlockStorage_Get(&c->sections[y / CHUNK_SIZE].blocks, BlockIndex(x, y % CHUNK_SIZE, z));
+}
+
+void SetChunkBlock(Chunk* c, int x, int y, int z, block_type type) {
+    BlockStorage_Set(&c->sections[y / CHUNK_SIZE].blocks, BlockIndex(x, y % CHUNK_SIZE, z), (BlockID)type);
+}
+
+bool IsChunkBlockSolid(const Chunk* c, int x, int y, int z) {
+    return GetChunkBlock(c, x, y, z) != BLOCK_AIR;
+}
+
+vec3 ChunkBlockPosition(const Chunk* c, int x, int y, int z, float voxelSize) {
+    return (vec3){
+        c->position.x + x * voxelSize,
+        c->position.y + y * voxelSize,
+        c->position.z + z * voxelSize
+    };
+}
+
+size_t ChunkMemoryUsage(const Chunk* c) {
+    size_t bytes = sizeof(Chunk);
+    for (int i = 0; i < CHUNK_SECTIONS; i++)
+        bytes += BlockStorage_MemoryUsage(&c->sections[i].blocks);
+    return bytes;
+}
+
+// FNV-1a over the block IDs in storage order, section by section;
+// independent of palette layout and of whether a section is stored uniform.
+uint64_t ChunkChecksum(const Chunk* c) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (int s = 0; s < CHUNK_SECTIONS; s++) {
+        for (int i = 0; i < CHUNK_VOLUME; i++) {
+            BlockID id = BlockStorage_Get(&c->sections[s].blocks, i);
+            h = (h ^ (id & 0xff)) * 0x100000001b3ULL;
+            h = (h ^ (id >> 8)) * 0x100000001b3ULL;
+        }
+    }
+    return h;
+}
+
+static bool PutVarint(uint8_t** buf, size_t* size, size_t* capacity, uint32_t v) {
+    if (*size + 5 > *capacity) {
+        size_t newCapacity = *capacity ? *capacity * 2 : 4096;
+        uint8_t* grown = (uint8_t*)Memory_Realloc(MEM_TAG_VOXEL, *buf, newCapacity);
+        if (!grown) return false;
+        *buf = grown;
+        *capacity = newCapacity;
+    }
+    do {
+        uint8_t byte = v & 0x7f;
+        v >>= 7;
+        (*buf)[(*size)++] = byte | (v ? 0x80 : 0);
+    } while (v);
+    return true;
+}
+
+static bool GetVarint(const uint8_t** p, const uint8_t* end, uint32_t* v) {
+    *v = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (*p == end) return false;
+        uint8_t byte = *(*p)++;
+        *v |= (uint32_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+// Run-length codes every section in storage order as (block ID, run length)
+// varint pairs. Runs carry across rows, so air above the terrain and solid
+// ground below it collapse to a handful of runs, and a uniform section is a
+// single one.
+static bool EncodeSections(const Chunk* c, uint8_t** buf, size_t* size, size_t* capacity) {
+    for (int s = 0; s < CHUNK_SECTIONS; s++) {
+        const BlockStorage* blocks = &c->sections[s].blocks;
+        int i = 0;
+        while (i < CHUNK_VOLUME) {
+            BlockID id;
+            int run = BlockStorage_Run(blocks, i, &id);
+            if (!PutVarint(buf, size, capacity, id) ||
+                !PutVarint(buf, size, capacity, (uint32_t)run)) return false;
+            i += run;
+        }
+    }
+    return true;
+}
+
+static bool DecodeSections(Chunk* c, const uint8_t** p, const uint8_t* end) {
+    for (int s = 0; s < CHUNK_SECTIONS; s++) {
+        BlockStorage* blocks = &c->sections[s].blocks;
+        BlockStorage_Free(blocks);
+        BlockStorage_Init(blocks, BLOCK_AIR);
+
+        int i = 0;
+        while (i < CHUNK_VOLUME) {
+            uint32_t id, run;
+            if (!GetVarint(p, end, &id) || !GetVarint(p, end, &run)) return false;
+            if (run == 0 || run > (uint32_t)(CHUNK_VOLUME - i) || id >= BLOCK_TYPE_COUNT) return false;
+
+            if (run == CHUNK_VOLUME) BlockStorage_Init(blocks, (BlockID)id);
+            else BlockStorage_SetRun(blocks, i, (int)run, (BlockID)id);
+            i += run;
+        }
+    }
+    return true;
+}
+
+uint8_t* EncodeChunkBlocks(const Chunk* c, size_t* size) {
+    uint8_t* buf = NULL;
+    size_t capacity = 0;
+    *size = 0;
+    if (!EncodeSections(c, &buf, size, &capacity)) {
+        Memory_Free(MEM_TAG_VOXEL, buf);
+        *size = 0;
+        return NULL;
+    }
+    return buf;
+}
+
+// Replaces the blocks of every section. Fails on malformed input, leaving
+// the chunk's sections in an unspecified but valid state.
+bool DecodeChunkBlocks(Chunk* c, const uint8_t* data, size_t size) {
+    const uint8_t* p = data;
+    return DecodeSections(c, &p, data + size) && p == data + size;
+}
+
+// Everything needed to resume a chunk at the given stage: the stage, the
+// column heights its neighbours decorate from, and its blocks. Heights are
+// stored as zigzagged deltas and tree heights as runs, which keeps the
+// columns about as small as the blocks. A compressed chunk reuses its blob.
+uint8_t* SerializeChunk(const Chunk* c, ChunkState state, size_t* size) {
+    uint8_t* buf = NULL;
+    size_t capacity = 0;
+    *size = 0;
+
+    if (!PutVarint(&buf, size, &capacity, (uint32_t)state)) goto fail;
+    int previous = 0;
+    for (int i = 0; i < CHUNK_SIZE * CHUNK_SIZE; i++) {
+        int delta = c->surfaceHeights[i] - previous;
+        previous = c->surfaceHeights[i];
+        if (!PutVarint(&buf, size, &capacity, ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31))) goto fail;
+    }
+    for (int i = 0; i < CHUNK_SIZE * CHUNK_SIZE; ) {
+        int run = 1;
+        while (i + run < CHUNK_SIZE * CHUNK_SIZE && c->treeHeights[i + run] == c->treeHeights[i]) run++;
+        if (!PutVarint(&buf, size, &capacity, c->treeHeights[i]) ||
+            !PutVarint(&buf, size, &capacity, (uint32_t)run)) goto fail;
+        i += run;
+    }
+
+    if (c->compressed) {
+        if (*size + c->compressedSize > capacity) {
+            uint8_t* grown = (uint8_t*)Memory_Realloc(MEM_TAG_VOXEL, buf, *size + c->compressedSize);
+            if (!grown) goto fail;
+            buf = grown;
+        }
+        memcpy(buf + *size, c->compressed, c->compressedSize);
+        *size += c->compressedSize;
+    } else if (!EncodeSections(c, &buf, size, &capacity)) {
+        goto fail;
+    }
+    return buf;
+
+fail:
+    Memory_Free(MEM_TAG_VOXEL, buf);
+    *size = 0;
+    return NULL;
+}
+
+// Restores a serialized chunk without touching its state, which the caller
+// applies; returns false and leaves the chunk all air on malformed input.
+bool DeserializeChunk(Chunk* c, const uint8_t* data, size_t size, ChunkState* state) {
+    const uint8_t* p = data;
+    const uint8_t* end = data + size;
+    uint32_t v, run;
+
+    if (!GetVarint(&p, end, &v) || v < CHUNK_TERRAIN || v > CHUNK_LIT) goto fail;
+    *state = (ChunkState)v;
+    int previous = 0;
+    for (int i = 0; i < CHUNK_SIZE * CHUNK_SIZE; i++) {
+        if (!GetVarint(&p, end, &v)) goto fail;
+        previous += (int)(v >> 1) ^ -(int)(v & 1);
+        if (previous < 0 || previous >= WORLD_HEIGHT) goto fail;
+        c->surfaceHeights[i] = (uint16_t)previous;
+    }
+    for (int i = 0; i < CHUNK_SIZE * CHUNK_SIZE; i += run) {
+        if (!GetVarint(&p, end, &v) || !GetVarint(&p, end, &run)) goto fail;
+        if (v > 255 || run == 0 || run > (uint32_t)(CHUNK_SIZE * CHUNK_SIZE - i)) goto fail;
+        memset(&c->treeHeights[i], (int)v, run);
+    }
+    if (DecodeSections(c, &p, end) && p == end) {
+        c->savedState = *state;
+        return true;
+    }
+
+fail:
+    for (int s = 0; s < CHUNK_SECTIONS; s++) {
+        BlockStorage_Free(&c->sections[s].blocks);
+        BlockStorage_Init(&c->sections[s].blocks, BLOCK_AIR);
+    }
+    return false;
+}
+
+// Moves the chunk's blocks into the compressed tier. Only idle chunks can be
+// compressed, since workers may read or write the sections of busy ones.
+bool CompressChunk(Chunk* c) {
+    if (c->busy || c->compressed) return false;
+
+    size_t size;
+    uint8_t* data = EncodeChunkBlocks(c, &size);
+    if (!data) return false;
+
+    for (int s = 0; s < CHUNK_SECTIONS; s++) {
+        BlockStorage_Free(&c->sections[s].blocks);
+        BlockStorage_Init(&c->sections[s].blocks, BLOCK_AIR);
+    }
+    c->compressed = data;
+    c->compressedSize = size;
+    return true;
 }
 
-Block* CreateBlock(vec3 pos, block_type type) {
-    Block* b = (Block*)malloc(sizeof(Block));
-    if (!b) return NULL;
-    b->active = true;
-    b->type = type;
-    b->position = pos;
-    b->color = BlockTypeToColor(type);
-    return b;
+bool DecompressChunk(Chunk* c) {
+    if (!c->compressed) return true;
+    if (!DecodeChunkBlocks(c, c->compressed, c->compressedSize)) return false;
+
+    Memory_Free(MEM_TAG_VOXEL, c->compressed);
+    c->compressed = NULL;
+    c->compressedSize = 0;
+    return true;
 }
 
 vec3 BlockTypeToColor(block_type type) {
-    vec3 baseColor;
     switch(type) {
-        case BLOCK_GRASS: baseColor = (vec3){0.4f, 0.8f, 0.4f}; break;
-        case BLOCK_STONE: baseColor = (vec3){0.6f, 0.6f, 0.65f}; break;
-        case BLOCK_WOOD:  baseColor = (vec3){0.55f, 0.35f, 0.2f}; break;
-        default:          baseColor = (vec3){1.0f, 1.0f, 1.0f}; break;
+        case BLOCK_GRASS: return (vec3){0.4f, 0.8f, 0.4f};
+        case BLOCK_STONE: return (vec3){0.6f, 0.6f, 0.65f};
+        case BLOCK_WOOD:  return (vec3){0.55f, 0.35f, 0.2f};
+        default:          return (vec3){1.0f, 1.0f, 1.0f};
     }
+}
 
-    float variation = 0.05f;
-    baseColor.x += ((float)rand() / RAND_MAX - 0.5f) * 2.0f * variation;
-    baseColor.y += ((float)rand() / RAND_MAX - 0.5f) * 2.0f * variation;
-    baseColor.z += ((float)rand() / RAND_MAX - 0.5f) * 2.0f * variation;
+void BuildChunkNeighborhood(const ChunkMap* map, const Chunk* c, int section, ChunkNeighborhood* out) {
+    for (int i = 0; i < CHUNK_PADDED * CHUNK_PADDED * CHUNK_PADDED; i++)
+        out->blocks[i] = BLOCK_AIR;
+
+    // Each column contributes only the voxels that fall inside the padded
+    // range: a face slice for edge neighbours, one column for diagonal ones,
+    // plus the layers just above and below the section.
+    int base = section * CHUNK_SIZE;
+    int y0 = section > 0 ? -1 : 0;
+    int y1 = section < CHUNK_SECTIONS - 1 ? CHUNK_SIZE : CHUNK_SIZE - 1;
+    for (int dx = -1; dx <= 1; dx++) {
+        for (int dz = -1; dz <= 1; dz++) {
+            const Chunk* n = (dx == 0 && dz == 0) ? c : ChunkMap_Get(map, c->chunkX + dx, c->chunkZ + dz);
+            if (!n || n->state < CHUNK_DECORATED || n->compressed) continue;
+
+            int x0 = dx < 0 ? -1 : (dx > 0 ? CHUNK_SIZE : 0);
+            int x1 = dx < 0 ? -1 : (dx > 0 ? CHUNK_SIZE : CHUNK_SIZE - 1);
+            int z0 = dz < 0 ? -1 : (dz > 0 ? CHUNK_SIZE : 0);
+            int z1 = dz < 0 ? -1 : (dz > 0 ? CHUNK_SIZE : CHUNK_SIZE - 1);
+
+            for (int y = y0; y <= y1; y++) {
+                const BlockStorage* src = &n->sections[(base + y) / CHUNK_SIZE].blocks;
+                int sy = (base + y) % CHUNK_SIZE;
+                for (int z = z0; z <= z1; z++)
+                    for (int x = x0; x <= x1; x++)
+                        out->blocks[PaddedBlockIndex(x, y, z)] = BlockStorage_Get(src,
+                            BlockIndex(x - dx * CHUNK_SIZE, sy, z - dz * CHUNK_SIZE));
+            }
+        }
+    }
+    for (int y = 0; y < CHUNK_PADDED; y++) {
+        for (int z = 0; z < CHUNK_PADDED; z++) {
+            const BlockID* row = &out->blocks[(y * CHUNK_PADDED + z) * CHUNK_PADDED];
+            uint64_t bits = 0;
+            for (int x = 0; x < CHUNK_PADDED; x++)
+                if (row[x] != BLOCK_AIR) bits |= 1ull << x;
+            out->solid[y][z] = bits;
+        }
+    }
+}
 
-    baseColor.x = fminf(fmaxf(baseColor.x, 0.0f), 1.0f);
-    baseColor.y = fminf(fmaxf(baseColor.y, 0.0f), 1.0f);
-    baseColor.z = fminf(fmaxf(baseColor.z, 0.0f), 1.0f);
+// True if every voxel of layer `layer` along `axis` (0 = x, 1 = y, 2 = z)
+// is solid.
+static bool SectionLayerSolid(const BlockStorage* s, int axis, int layer) {
+    BlockID id;
+    if (BlockStorage_IsUniform(s, &id)) return id != BLOCK_AIR;
+
+    for (int a = 0; a < CHUNK_SIZE; a++) {
+        for (int b = 0; b < CHUNK_SIZE; b++) {
+            int index = axis == 0 ? BlockIndex(layer, a, b)
+                      : axis == 1 ? BlockIndex(a, layer, b)
+                                  : BlockIndex(a, b, layer);
+            if (BlockStorage_Get(s, index) == BLOCK_AIR) return false;
+        }
+    }
+    return true;
+}
 
-    return baseColor;
+// A section has something to draw unless it is all air, or all solid and
+// closed off on every side by solid layers of the sections around it.
+static bool SectionNeedsMesh(const ChunkMap* map, const Chunk* c, int section) {
+    BlockID id;
+    if (!BlockStorage_IsUniform(&c->sections[section].blocks, &id)) return true;
+    if (id == BLOCK_AIR) return false;
+
+    if (section == 0 || section == CHUNK_SECTIONS - 1) return true;
+    if (!SectionLayerSolid(&c->sections[section - 1].blocks, 1, CHUNK_SIZE - 1) ||
+        !SectionLayerSolid(&c->sections[section + 1].blocks, 1, 0))
+        return true;
+
+    static const int sides[4][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+    for (int i = 0; i < 4; i++) {
+        int dx = sides[i][0], dz = sides[i][1];
+        const Chunk* n = ChunkMap_Get(map, c->chunkX + dx, c->chunkZ + dz);
+        if (!n || n->state < CHUNK_DECORATED || n->compressed) return true;
+
+        int axis = dx ? 0 : 2;
+        int layer = (dx + dz) < 0 ? CHUNK_SIZE - 1 : 0;
+        if (!SectionLayerSolid(&n->sections[section].blocks, axis, layer)) return true;
+    }
+    return false;
 }
 
-Chunk* GetOrCreateChunk(ChunkSlot* slots, int maxSlots, int chunkX, int chunkZ, float voxelSize, int chunkSize) {
-    for (int i = 0; i < maxSlots; i++) {
-        if (slots[i].loaded && slots[i].chunkX == chunkX && slots[i].chunkZ == chunkZ) {
-            return slots[i].chunk;
-        }
+ChunkMeshInput* BuildChunkMeshInput(const ChunkMap* map, const Chunk* c) {
+    int sections[CHUNK_SECTIONS];
+    int count = 0;
+    for (int i = 0; i < CHUNK_SECTIONS; i++)
+        if (SectionNeedsMesh(map, c, i)) sections[count++] = i;
+
+    ChunkMeshInput* in = (ChunkMeshInput*)Memory_Alloc(MEM_TAG_MESH_SCRATCH, sizeof(ChunkMeshInput) + count * sizeof(ChunkNeighborhood));
+    if (!in) return NULL;
+    in->sectionCount = count;
+    for (int i = 0; i < count; i++) {
+        in->sections[i] = sections[i];
+        BuildChunkNeighborhood(map, c, sections[i], &in->neighborhoods[i]);
     }
+    return in;
+}
 
-    int emptySlot = -1;
-    for (int i = 0; i < maxSlots; i++) {
-        if (!slots[i].loaded) {
-            emptySlot = i;
-            break;
+block_type GetNeighborhoodBlock(const ChunkNeighborhood* n, int x, int y, int z) {
+    return (block_type)n->blocks[PaddedBlockIndex(x, y, z)];
+}
+
+// Compressed neighbours read as air in a neighbourhood, so they don't count
+// until they are restored.
+static bool NeighborsReached(const ChunkMap* map, const Chunk* c, ChunkState state) {
+    for (int dx = -1; dx <= 1; dx++) {
+        for (int dz = -1; dz <= 1; dz++) {
+            if (dx == 0 && dz == 0) continue;
+            const Chunk* n = ChunkMap_Get(map, c->chunkX + dx, c->chunkZ + dz);
+            if (!n || n->state < state || n->compressed) return false;
         }
     }
+    return true;
+}
 
-    if (emptySlot == -1) {
-        emptySlot = 0;
-        if (slots[emptySlot].chunk) {
-            extern void FreeChunkMesh(Chunk* chunk);
-            FreeChunkMesh(slots[emptySlot].chunk);
-            for (int x = 0; x < chunkSize; x++)
-                for (int y = 0; y < chunkSize; y++)
-                    for (int z = 0; z < chunkSize; z++)
-                        if (slots[emptySlot].chunk->blocks[x][y][z])
-                            free(slots[emptySlot].chunk->blocks[x][y][z]);
-            free(slots[emptySlot].chunk);
+// A compressed chunk coming back into range is restored, and the meshed
+// chunks around it are remeshed, since any mesh built while it was
+// compressed saw air in its place.
+Chunk* RequestChunk(ChunkMap* map, struct ChunkWorkerPool* pool, int chunkX, int chunkZ, float voxelSize, int chunkSize) {
+    Chunk* existing = ChunkMap_Get(map, chunkX, chunkZ);
+    if (existing) {
+        if (existing->compressed && DecompressChunk(existing)) {
+            for (int dx = -1; dx <= 1; dx++) {
+                for (int dz = -1; dz <= 1; dz++) {
+                    Chunk* n = ChunkMap_Get(map, chunkX + dx, chunkZ + dz);
+                    if (n && n != existing && n->state == CHUNK_MESHED) RequestChunkRemesh(map, pool, n);
+                }
+            }
         }
+        return existing;
     }
 
     float chunkWorldSize = chunkSize * voxelSize;
@@ -295,64 +678,209 @@ Chunk* GetOrCreateChunk(ChunkSlot* slots, int maxSlots, int chunkX, int chunkZ,
         chunkZ * chunkWorldSize
     };
 
-    slots[emptySlot].chunk = CreateChunk(chunkPos, chunkSize, voxelSize);
-    slots[emptySlot].chunkX = chunkX;
-    slots[emptySlot].chunkZ = chunkZ;
-    slots[emptySlot].loaded = true;
+    Chunk* c = AllocateChunk(chunkPos, chunkX, chunkZ, voxelSize);
+    if (!c) return NULL;
+    if (!ChunkMap_Insert(map, chunkX, chunkZ, c)) {
+        FreeChunk(c);
+        return NULL;
+    }
 
-    extern void BuildChunkMesh(Chunk* chunk, int size, float voxelSize);
-    BuildChunkMesh(slots[emptySlot].chunk, chunkSize, voxelSize);
+    return c;
+}
 
-    return slots[emptySlot].chunk;
+void RequestChunkRemesh(ChunkMap* map, struct ChunkWorkerPool* pool, Chunk* c) {
+    if (c->state < CHUNK_LIT || c->compressed || !NeighborsReached(map, c, CHUNK_DECORATED)) return;
+    if (c->busy) {
+        c->dirty = true;
+        return;
+    }
+    ChunkMeshInput* in = BuildChunkMeshInput(map, c);
+    if (in && !ChunkWorkers_Submit(pool, c, CHUNK_MESHED, in))
+        Memory_Free(MEM_TAG_MESH_SCRATCH, in);
 }
 
-void UpdateChunkLoading(ChunkSlot* slots, int maxSlots, vec3 playerPos, float voxelSize, int chunkSize, int renderDist) {
-    float chunkWorldSize = chunkSize * voxelSize;
+static int CompareChunkPriority(const void* a, const void* b) {
+    float pa = (*(Chunk* const*)a)->priority;
+    float pb = (*(Chunk* const*)b)->priority;
+    return pa < pb ? -1 : (pa > pb ? 1 : 0);
+}
 
-    int playerChunkX = (int)floorf(playerPos.x / chunkWorldSize);
-    int playerChunkZ = (int)floorf(playerPos.z / chunkWorldSize);
+// Monotonic milliseconds, for the per-frame streaming budget.
+double ChunkClockMs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
 
-    int halfDist = renderDist / 2;
-    for (int cx = playerChunkX - halfDist; cx <= playerChunkX + halfDist; cx++) {
-        for (int cz = playerChunkZ - halfDist; cz <= playerChunkZ + halfDist; cz++) {
-            GetOrCreateChunk(slots, maxSlots, cx, cz, voxelSize, chunkSize);
-        }
+// Moves every idle chunk whose dependencies are met to its next stage, one
+// stage at a time and most wanted first, so each stage's jobs go to the pool
+// as a single batch.
+// A stage's job is only ever queued once its inputs are final, so no chunk is
+// generated or meshed twice because a neighbour arrived late.
+// Building decoration and mesh snapshots is the costly part; past deadline
+// the remaining ones wait for the next call, though at least one is built.
+void AdvanceChunkPipeline(ChunkMap* map, struct ChunkWorkerPool* pool, double deadline) {
+    ChunkJob* jobs = (ChunkJob*)Memory_Alloc(MEM_TAG_VOXEL, map->count * sizeof(ChunkJob));
+    Chunk** ready = (Chunk**)Memory_Alloc(MEM_TAG_VOXEL, map->count * sizeof(Chunk*));
+    if (!jobs || !ready) {
+        Memory_Free(MEM_TAG_VOXEL, jobs);
+        Memory_Free(MEM_TAG_VOXEL, ready);
+        return;
     }
 
-    for (int i = 0; i < maxSlots; i++) {
-        if (slots[i].loaded) {
-            int dx = abs(slots[i].chunkX - playerChunkX);
-            int dz = abs(slots[i].chunkZ - playerChunkZ);
-
-            if (dx > halfDist + 1 || dz > halfDist + 1) {
-                extern void FreeChunkMesh(Chunk* chunk);
-                FreeChunkMesh(slots[i].chunk);
-                for (int x = 0; x < chunkSize; x++)
-                    for (int y = 0; y < chunkSize; y++)
-                        for (int z = 0; z < chunkSize; z++)
-                            if (slots[i].chunk->blocks[x][y][z])
-                                free(slots[i].chunk->blocks[x][y][z]);
-                free(slots[i].chunk);
-                slots[i].chunk = NULL;
-                slots[i].loaded = false;
+    bool built = false;
+    for (ChunkState stage = CHUNK_TERRAIN; stage <= CHUNK_MESHED; stage++) {
+        int readyCount = 0;
+        for (int i = 0; i < map->capacity; i++) {
+            Chunk* c = map->entries[i].chunk;
+            if (!c || c->busy || !c->inRange || c->compressed || c->state != stage - 1) continue;
+            ready[readyCount++] = c;
+        }
+        qsort(ready, readyCount, sizeof(Chunk*), CompareChunkPriority);
+
+        int jobCount = 0;
+        for (int i = 0; i < readyCount; i++) {
+            Chunk* c = ready[i];
+            void* input = NULL;
+            switch (stage) {
+                case CHUNK_DECORATED:
+                    if (!NeighborsReached(map, c, CHUNK_TERRAIN)) continue;
+                    if (built && ChunkClockMs() >= deadline) continue;
+                    built = true;
+                    input = Memory_Alloc(MEM_TAG_VOXEL, sizeof(ChunkDecorationInput));
+                    if (!input) continue;
+                    BuildChunkDecorationInput(map, c, (ChunkDecorationInput*)input);
+                    break;
+                case CHUNK_LIT:
+                    // Light is baked into the mesh as AO, so this stage only
+                    // records that the neighbourhood is final.
+                    if (NeighborsReached(map, c, CHUNK_DECORATED)) c->state = CHUNK_LIT;
+                    continue;
+                case CHUNK_MESHED:
+                    if (!NeighborsReached(map, c, CHUNK_DECORATED)) continue;
+                    if (built && ChunkClockMs() >= deadline) continue;
+                    built = true;
+                    input = BuildChunkMeshInput(map, c);
+                    if (!input) continue;
+                    break;
+                default:
+                    break;
             }
+            jobs[jobCount++] = (ChunkJob){c, stage, input};
+        }
+        // Out of memory: the chunks stay idle and are retried next update.
+        if (!ChunkWorkers_SubmitBatch(pool, jobs, jobCount)) {
+            for (int i = 0; i < jobCount; i++)
+                Memory_Free(ChunkJobInputTag(stage), jobs[i].input);
         }
     }
+    Memory_Free(MEM_TAG_VOXEL, jobs);
+    Memory_Free(MEM_TAG_VOXEL, ready);
 }
 
-void FreeAllChunks(ChunkSlot* slots, int maxSlots, int chunkSize) {
+void UnloadChunk(Chunk* c) {
     extern void FreeChunkMesh(Chunk* chunk);
-    for (int i = 0; i < maxSlots; i++) {
-        if (slots[i].loaded && slots[i].chunk) {
-            FreeChunkMesh(slots[i].chunk);
-            for (int x = 0; x < chunkSize; x++)
-                for (int y = 0; y < chunkSize; y++)
-                    for (int z = 0; z < chunkSize; z++)
-                        if (slots[i].chunk->blocks[x][y][z])
-                            free(slots[i].chunk->blocks[x][y][z]);
-            free(slots[i].chunk);
-            slots[i].chunk = NULL;
-            slots[i].loaded = false;
+
+    // A worker still owns the blocks of busy chunks; the pool frees them on
+    // completion. Workers never touch the mesh, so it can go now.
+    FreeChunkMesh(c);
+    if (c->busy) {
+        c->cancelled = true;
+        return;
+    }
+    FreeChunk(c);
+}
+
+// How far ahead of the player's movement chunks are requested.
+#define CHUNK_PREFETCH_SECONDS 2.0f
+
+static bool InSquare(int cx, int cz, int centerX, int centerZ, int dist) {
+    return abs(cx - centerX) <= dist && abs(cz - centerZ) <= dist;
+}
+
+void UpdateChunkLoading(ChunkMap* map, struct ChunkWorkerPool* pool, ChunkCache* cache, const ChunkView* view, float voxelSize, int chunkSize, int renderDist) {
+    float chunkWorldSize = chunkSize * voxelSize;
+    vec3 ahead = Vec3Add(view->position, Vec3Scale(view->velocity, CHUNK_PREFETCH_SECONDS));
+
+    int playerChunkX = (int)floorf(view->position.x / chunkWorldSize);
+    int playerChunkZ = (int)floorf(view->position.z / chunkWorldSize);
+    int aheadChunkX = (int)floorf(ahead.x / chunkWorldSize);
+    int aheadChunkZ = (int)floorf(ahead.z / chunkWorldSize);
+
+    // Generation runs two chunks past the meshed radius: decoration needs the
+    // ring beyond it generated, and lighting needs that ring decorated. The
+    // ring is also requested around where the player is heading.
+    int halfDist = renderDist / 2;
+    int generateDist = halfDist + 2;
+    cache->tick++;
+    int minX = (playerChunkX < aheadChunkX ? playerChunkX : aheadChunkX) - generateDist;
+    int maxX = (playerChunkX > aheadChunkX ? playerChunkX : aheadChunkX) + generateDist;
+    int minZ = (playerChunkZ < aheadChunkZ ? playerChunkZ : aheadChunkZ) - generateDist;
+    int maxZ = (playerChunkZ > aheadChunkZ ? playerChunkZ : aheadChunkZ) + generateDist;
+    for (int cx = minX; cx <= maxX; cx++) {
+        for (int cz = minZ; cz <= maxZ; cz++) {
+            if (!InSquare(cx, cz, playerChunkX, playerChunkZ, generateDist) &&
+                !InSquare(cx, cz, aheadChunkX, aheadChunkZ, generateDist)) continue;
+            Chunk* c = RequestChunk(map, pool, cx, cz, voxelSize, chunkSize);
+            if (c) c->lastSeen = cache->tick;
         }
     }
+
+    // Priority is the distance in chunks to the player or to the predicted
+    // position, whichever is closer, scaled from 1x straight ahead of the
+    // camera to 2x behind it.
+    float frontLength = sqrtf(view->front.x * view->front.x + view->front.z * view->front.z);
+    float frontX = frontLength > 0.0f ? view->front.x / frontLength : 0.0f;
+    float frontZ = frontLength > 0.0f ? view->front.z / frontLength : 0.0f;
+    for (int i = 0; i < map->capacity; i++) {
+        Chunk* c = map->entries[i].chunk;
+        if (!c) continue;
+        c->inRange = InSquare(c->chunkX, c->chunkZ, playerChunkX, playerChunkZ, generateDist) ||
+                     InSquare(c->chunkX, c->chunkZ, aheadChunkX, aheadChunkZ, generateDist);
+
+        float toX = c->position.x + chunkWorldSize * 0.5f - view->position.x;
+        float toZ = c->position.z + chunkWorldSize * 0.5f - view->position.z;
+        float aheadX = c->position.x + chunkWorldSize * 0.5f - ahead.x;
+        float aheadZ = c->position.z + chunkWorldSize * 0.5f - ahead.z;
+        float dist = sqrtf(toX * toX + toZ * toZ);
+        float aheadDist = sqrtf(aheadX * aheadX + aheadZ * aheadZ);
+        float facing = dist > 0.0f ? (toX * frontX + toZ * frontZ) / dist : 1.0f;
+        c->priority = (dist < aheadDist ? dist : aheadDist) / chunkWorldSize * (1.5f - 0.5f * facing);
+    }
+
+    // Work queued for chunks that left the ring is dropped before it starts;
+    // chunks outside the ring stay resident until the cache needs the room.
+    ChunkWorkers_Reprioritize(pool);
+    ChunkCache_Trim(cache, map, playerChunkX, playerChunkZ, generateDist);
+}
+
+void RemeshLoadedChunks(ChunkMap* map, struct ChunkWorkerPool* pool) {
+    for (int i = 0; i < map->capacity; i++) {
+        Chunk* c = map->entries[i].chunk;
+        if (c) RequestChunkRemesh(map, pool, c);
+    }
+}
+
+// Chunks still being worked on are dropped without being saved.
+void FreeAllChunks(ChunkMap* map, RegionStore* store) {
+    for (int i = 0; i < map->capacity; i++) {
+        ChunkMapEntry* e = &map->entries[i];
+        if (!e->chunk) continue;
+
+        RegionStore_Save(store, e->chunk);
+        UnloadChunk(ChunkMap_Remove(map, e->chunkX, e->chunkZ));
+    }
+}
+
+block_type GetWorldBlock(const ChunkMap* map, vec3 worldPos, int chunkSize, float voxelSize) {
+    int bx = (int)floorf(worldPos.x / voxelSize);
+    int by = (int)floorf(worldPos.y / voxelSize);
+    int bz = (int)floorf(worldPos.z / voxelSize);
+
+    int cx = bx >= 0 ? bx / chunkSize : (bx + 1) / chunkSize - 1;
+    int cz = bz >= 0 ? bz / chunkSize : (bz + 1) / chunkSize - 1;
+
+    Chunk* c = ChunkMap_Get(map, cx, cz);
+    if (!c || c->state < CHUNK_DECORATED || c->compressed) return BLOCK_AIR;
+    return GetChunkBlock(c, bx - cx * chunkSize, by, bz - cz * chunkSize);
 }
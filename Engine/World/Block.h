@@ -2,45 +2,160 @@
 #define BLOCK_H
 #include <stdbool.h>
 #include "../utils/MathUtil.h"
+#include "BlockStorage.h"
+#include "ChunkMap.h"
+#include "../Memory.h"
 #include <GL/gl.h>
 
 typedef enum {
+    BLOCK_AIR,
     BLOCK_GRASS,
     BLOCK_STONE,
-    BLOCK_WOOD
+    BLOCK_WOOD,
+    BLOCK_TYPE_COUNT
 } block_type;
 
-typedef struct {
-    bool active;
-    block_type type;
-    vec3 position;
-    vec3 color;
-} Block;
+// Generation stages, in order. A chunk's state is the last stage it finished.
+// Decoration needs the column data of all eight neighbours, lighting needs
+// them decorated, and only lit chunks are meshed.
+typedef enum {
+    CHUNK_EMPTY,
+    CHUNK_TERRAIN,
+    CHUNK_CARVED,
+    CHUNK_DECORATED,
+    CHUNK_LIT,
+    CHUNK_MESHED
+} ChunkState;
 
+// A chunk is a column of CHUNK_SECTIONS cubic sections stacked from y = 0.
+#define CHUNK_SECTIONS 8
+#define WORLD_HEIGHT (CHUNK_SECTIONS * CHUNK_SIZE)
+
+// One 32^3 cube of a column, meshed and drawn on its own. origin is the
+// world position of its (0, 0, 0) voxel; its mesh is meshVertexCount vertices
+// of the shared chunk arena starting at meshFirst.
 typedef struct {
-    Block* blocks[32][32][32];
-    vec3 position;
-    GLuint meshVAO;
-    GLuint meshVBO;
+    BlockStorage blocks;
+    vec3 origin;
+    GLuint meshFirst;
     GLuint meshVertexCount;
-} Chunk;
+    vec3 boundsMin;
+    vec3 boundsMax;
+} ChunkSection;
 
-typedef struct {
-    Chunk* chunk;
+typedef struct Chunk {
+    ChunkSection sections[CHUNK_SECTIONS];
+    vec3 position;
     int chunkX;
     int chunkZ;
-    bool loaded;
-} ChunkSlot;
+    ChunkState state;
+    bool busy;
+    bool dirty;
+    bool cancelled;
+    // Set while the chunk sits in the compressed tier: its sections are
+    // released and the blocks live in this blob until the chunk is needed.
+    uint8_t* compressed;
+    size_t compressedSize;
+    uint32_t lastSeen;
+    // Inside the load ring as of the last loading update. Only these advance
+    // through the pipeline; the rest just wait in the cache.
+    bool inRange;
+    // Latest stage written to the region store, so unchanged chunks aren't
+    // written again.
+    ChunkState savedState;
+    // Scheduling order, lowest first; see UpdateChunkLoading.
+    float priority;
+    uint16_t surfaceHeights[CHUNK_SIZE * CHUNK_SIZE];
+    uint8_t treeHeights[CHUNK_SIZE * CHUNK_SIZE];
+} Chunk;
+
+#define CHUNK_PADDED (CHUNK_SIZE + 2)
+
+// A section's blocks plus a one-voxel border copied from the sections around
+// it, so the mesher can cull faces and compute AO across seams off the main
+// thread.
+// Coordinates run from -1 to CHUNK_SIZE on every axis.
+// solid[y+1][z+1] has bit x+1 set for every non-air block of that row.
+typedef struct {
+    BlockID blocks[CHUNK_PADDED * CHUNK_PADDED * CHUNK_PADDED];
+    uint64_t solid[CHUNK_PADDED][CHUNK_PADDED];
+} ChunkNeighborhood;
 
-Block* CreateBlock(vec3 pos, block_type type);
+static inline int PaddedBlockIndex(int x, int y, int z) {
+    return ((y + 1) * CHUNK_PADDED + (z + 1)) * CHUNK_PADDED + (x + 1);
+}
+
+// Column data of a chunk and its eight neighbours, indexed [dx+1][dz+1] and
+// copied on the main thread, so decoration can pull in the parts of
+// neighbouring trees that overhang the chunk.
+typedef struct {
+    bool present[3][3];
+    uint16_t surfaceHeights[3][3][CHUNK_SIZE * CHUNK_SIZE];
+    uint8_t treeHeights[3][3][CHUNK_SIZE * CHUNK_SIZE];
+} ChunkDecorationInput;
+
+// Snapshots for one mesh job: neighborhoods[i] belongs to section
+// sections[i]. Sections left out have nothing to draw.
+typedef struct {
+    int sectionCount;
+    int sections[CHUNK_SECTIONS];
+    ChunkNeighborhood neighborhoods[];
+} ChunkMeshInput;
+
+// Decoration inputs are column data, mesh inputs are block snapshots.
+static inline MemoryTag ChunkJobInputTag(ChunkState stage) {
+    return stage == CHUNK_DECORATED ? MEM_TAG_VOXEL : MEM_TAG_MESH_SCRATCH;
+}
+
+// Where the player is, where the camera looks and how fast the player is
+// moving, for ordering chunk work. front need not be normalised.
+typedef struct {
+    vec3 position;
+    vec3 front;
+    vec3 velocity;
+} ChunkView;
+
+struct ChunkWorkerPool;
+struct ChunkCache;
+struct RegionStore;
+
+Chunk* AllocateChunk(vec3 pos, int chunkX, int chunkZ, float voxelSize);
 Chunk* CreateChunk(vec3 pos, int size, float voxelSize);
+void GenerateChunkTerrain(Chunk* c, int size, float voxelSize);
+void CarveChunk(Chunk* c, int size, float voxelSize);
+void BuildChunkDecorationInput(const ChunkMap* map, const Chunk* c, ChunkDecorationInput* out);
+void DecorateChunk(Chunk* c, const ChunkDecorationInput* in, int size);
+void FreeChunk(Chunk* c);
+void UnloadChunk(Chunk* c);
 vec3 BlockTypeToColor(block_type type);
 
+block_type GetChunkBlock(const Chunk* c, int x, int y, int z);
+void SetChunkBlock(Chunk* c, int x, int y, int z, block_type type);
+bool IsChunkBlockSolid(const Chunk* c, int x, int y, int z);
+vec3 ChunkBlockPosition(const Chunk* c, int x, int y, int z, float voxelSize);
+size_t ChunkMemoryUsage(const Chunk* c);
+uint64_t ChunkChecksum(const Chunk* c);
+uint8_t* EncodeChunkBlocks(const Chunk* c, size_t* size);
+bool DecodeChunkBlocks(Chunk* c, const uint8_t* data, size_t size);
+bool CompressChunk(Chunk* c);
+bool DecompressChunk(Chunk* c);
+uint8_t* SerializeChunk(const Chunk* c, ChunkState state, size_t* size);
+bool DeserializeChunk(Chunk* c, const uint8_t* data, size_t size, ChunkState* state);
+
+void BuildChunkNeighborhood(const ChunkMap* map, const Chunk* c, int section, ChunkNeighborhood* out);
+ChunkMeshInput* BuildChunkMeshInput(const ChunkMap* map, const Chunk* c);
+block_type GetNeighborhoodBlock(const ChunkNeighborhood* n, int x, int y, int z);
+
 void InitWorldSeed(int seed);
 int GetWorldSeed(void);
 
-Chunk* GetOrCreateChunk(ChunkSlot* slots, int maxSlots, int chunkX, int chunkZ, float voxelSize, int chunkSize);
-void UpdateChunkLoading(ChunkSlot* slots, int maxSlots, vec3 playerPos, float voxelSize, int chunkSize, int renderDist);
-void FreeAllChunks(ChunkSlot* slots, int maxSlots, int chunkSize);
+double ChunkClockMs(void);
+Chunk* RequestChunk(ChunkMap* map, struct ChunkWorkerPool* pool, int chunkX, int chunkZ, float voxelSize, int chunkSize);
+void UpdateChunkLoading(ChunkMap* map, struct ChunkWorkerPool* pool, struct ChunkCache* cache, const ChunkView* view, float voxelSize, int chunkSize, int renderDist);
+void AdvanceChunkPipeline(ChunkMap* map, struct ChunkWorkerPool* pool, double deadline);
+void RequestChunkRemesh(ChunkMap* map, struct ChunkWorkerPool* pool, Chunk* c);
+void RemeshLoadedChunks(ChunkMap* map, struct ChunkWorkerPool* pool);
+void FreeAllChunks(ChunkMap* map, struct RegionStore* store);
+block_type GetWorldBlock(const ChunkMap* map, vec3 worldPos, int chunkSize, float voxelSize);
 
 #endif
@@ -0,0 +1,172 @@
+#include "BlockStorage.h"
+#include "../Memory.h"
+#include <stdlib.h>
+#include <string.h>
+
+static size_t DataBytes(int bits) {
+    return (size_t)CHUNK_VOLUME * bits / 8;
+}
+
+static int ReadIndex(const uint8_t* data, int bits, int index) {
+    switch (bits) {
+        case 4:  return (data[index >> 1] >> ((index & 1) << 2)) & 0xF;
+        case 8:  return data[index];
+        default: return ((const uint16_t*)data)[index];
+    }
+}
+
+static void WriteIndex(uint8_t* data, int bits, int index, int value) {
+    switch (bits) {
+        case 4: {
+            int shift = (index & 1) << 2;
+            data[index >> 1] = (uint8_t)((data[index >> 1] & ~(0xF << shift)) | (value << shift));
+            break;
+        }
+        case 8:  data[index] = (uint8_t)value; break;
+        default: ((uint16_t*)data)[index] = (uint16_t)value; break;
+    }
+}
+
+bool BlockStorage_Init(BlockStorage* s, BlockID fill) {
+    *s = (BlockStorage){.uniform = fill};
+    return true;
+}
+
+void BlockStorage_Free(BlockStorage* s) {
+    Memory_Free(MEM_TAG_VOXEL, s->palette);
+    Memory_Free(MEM_TAG_VOXEL, s->data);
+    *s = (BlockStorage){0};
+}
+
+static bool MakeDense(BlockStorage* s) {
+    s->palette = (BlockID*)Memory_Alloc(MEM_TAG_VOXEL, 16 * sizeof(BlockID));
+    s->data = (uint8_t*)Memory_Calloc(MEM_TAG_VOXEL, DataBytes(4), 1);
+    if (!s->palette || !s->data) {
+        Memory_Free(MEM_TAG_VOXEL, s->palette);
+        Memory_Free(MEM_TAG_VOXEL, s->data);
+        s->palette = NULL;
+        s->data = NULL;
+        return false;
+    }
+    s->bits = 4;
+    s->paletteSize = 1;
+    s->palette[0] = s->uniform;
+    return true;
+}
+
+bool BlockStorage_IsUniform(const BlockStorage* s, BlockID* id) {
+    if (s->data) return false;
+    if (id) *id = s->uniform;
+    return true;
+}
+
+static bool Grow(BlockStorage* s) {
+    int newBits = s->bits == 4 ? 8 : 16;
+    BlockID* palette = (BlockID*)Memory_Realloc(MEM_TAG_VOXEL, s->palette, (1 << newBits) * sizeof(BlockID));
+    if (!palette) return false;
+    s->palette = palette;
+
+    uint8_t* data = (uint8_t*)Memory_Alloc(MEM_TAG_VOXEL, DataBytes(newBits));
+    if (!data) return false;
+    for (int i = 0; i < CHUNK_VOLUME; i++)
+        WriteIndex(data, newBits, i, ReadIndex(s->data, s->bits, i));
+
+    Memory_Free(MEM_TAG_VOXEL, s->data);
+    s->data = data;
+    s->bits = newBits;
+    return true;
+}
+
+BlockID BlockStorage_Get(const BlockStorage* s, int index) {
+    if (!s->data) return s->uniform;
+    return s->palette[ReadIndex(s->data, s->bits, index)];
+}
+
+// Length of the run of equal blocks starting at index, stopping at the end of
+// the store. Equal palette slots mean equal blocks, so 4 and 8 bit stores are
+// compared a word at a time instead of voxel by voxel.
+int BlockStorage_Run(const BlockStorage* s, int index, BlockID* id) {
+    if (!s->data) {
+        *id = s->uniform;
+        return CHUNK_VOLUME - index;
+    }
+    int p = ReadIndex(s->data, s->bits, index);
+    *id = s->palette[p];
+
+    int i = index + 1;
+    if (s->bits == 16) {
+        const uint16_t* d = (const uint16_t*)s->data;
+        while (i < CHUNK_VOLUME && d[i] == p) i++;
+        return i - index;
+    }
+
+    int shift = s->bits == 4 ? 1 : 0;
+    if (shift && (i & 1)) {
+        if (ReadIndex(s->data, 4, i) != p) return 1;
+        i++;
+    }
+    uint8_t pattern = (uint8_t)(shift ? p | (p << 4) : p);
+    uint64_t word = pattern * 0x0101010101010101ull;
+    int byte = i >> shift;
+    int end = CHUNK_VOLUME >> shift;
+    while (byte + 8 <= end) {
+        uint64_t v;
+        memcpy(&v, s->data + byte, 8);
+        if (v != word) break;
+        byte += 8;
+    }
+    while (byte < end && s->data[byte] == pattern) byte++;
+
+    // A mismatched byte can still open with one matching nibble.
+    i = byte << shift;
+    if (shift && i < CHUNK_VOLUME && ReadIndex(s->data, 4, i) == p) i++;
+    return i - index;
+}
+
+// Returns the palette slot for id, adding it if needed, or -1 if the store
+// couldn't grow.
+static int PaletteIndex(BlockStorage* s, BlockID id) {
+    int p = 0;
+    while (p < s->paletteSize && s->palette[p] != id) p++;
+
+    if (p == s->paletteSize) {
+        if (s->paletteSize == (1 << s->bits) && !Grow(s)) return -1;
+        s->palette[s->paletteSize++] = id;
+    }
+    return p;
+}
+
+void BlockStorage_Set(BlockStorage* s, int index, BlockID id) {
+    if (!s->data && (id == s->uniform || !MakeDense(s))) return;
+
+    int p = PaletteIndex(s, id);
+    if (p >= 0) WriteIndex(s->data, s->bits, index, p);
+}
+
+void BlockStorage_SetRun(BlockStorage* s, int index, int count, BlockID id) {
+    if (!s->data && (id == s->uniform || !MakeDense(s))) return;
+
+    int p = PaletteIndex(s, id);
+    if (p < 0) return;
+
+    int end = index + count;
+    if (s->bits == 8) {
+        memset(s->data + index, p, count);
+        return;
+    }
+    if (s->bits == 4) {
+        // Whole bytes hold two voxels; only an odd first or last voxel needs
+        // a nibble write.
+        if (index & 1) WriteIndex(s->data, 4, index++, p);
+        if (end > index && (end & 1)) WriteIndex(s->data, 4, --end, p);
+        if (end > index) memset(s->data + (index >> 1), p | (p << 4), (end - index) >> 1);
+        return;
+    }
+    for (int i = index; i < end; i++)
+        WriteIndex(s->data, s->bits, i, p);
+}
+
+size_t BlockStorage_MemoryUsage(const BlockStorage* s) {
+    if (!s->data) return 0;
+    return DataBytes(s->bits) + (size_t)(1 << s->bits) * sizeof(BlockID);
+}
@@ -0,0 +1,37 @@
+#ifndef BLOCKSTORAGE_H
+#define BLOCKSTORAGE_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define CHUNK_SIZE 32
+#define CHUNK_VOLUME (CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE)
+
+typedef uint16_t BlockID;
+
+// 32^3 block store. A uniform store is just the one block ID, with no voxel
+// array. The first differing write makes it dense: each voxel then holds a
+// 4, 8 or 16 bit index into a palette of block IDs, and the index width grows
+// as the palette does.
+typedef struct {
+    BlockID* palette;
+    int paletteSize;
+    int bits;
+    uint8_t* data;
+    BlockID uniform;
+} BlockStorage;
+
+static inline int BlockIndex(int x, int y, int z) {
+    return (y * CHUNK_SIZE + z) * CHUNK_SIZE + x;
+}
+
+bool BlockStorage_Init(BlockStorage* s, BlockID fill);
+void BlockStorage_Free(BlockStorage* s);
+bool BlockStorage_IsUniform(const BlockStorage* s, BlockID* id);
+BlockID BlockStorage_Get(const BlockStorage* s, int index);
+int BlockStorage_Run(const BlockStorage* s, int index, BlockID* id);
+void BlockStorage_Set(BlockStorage* s, int index, BlockID id);
+void BlockStorage_SetRun(BlockStorage* s, int index, int count, BlockID id);
+size_t BlockStorage_MemoryUsage(const BlockStorage* s);
+
+#endif
@@ -0,0 +1,100 @@
+#include "ChunkCache.h"
+#include "../Renderer.h"
+#include <stdlib.h>
+
+typedef struct {
+    Chunk* chunk;
+    uint32_t score;
+} EvictionCandidate;
+
+void ChunkCache_Init(ChunkCache* cache, size_t voxelBudget, size_t gpuBudget, size_t compressedBudget, RegionStore* store) {
+    *cache = (ChunkCache){0};
+    cache->store = store;
+    cache->voxelBudget = voxelBudget;
+    cache->gpuBudget = gpuBudget;
+    cache->compressedBudget = compressedBudget;
+}
+
+size_t ChunkCache_MeshBytes(const Chunk* c) {
+    size_t bytes = 0;
+    for (int i = 0; i < CHUNK_SECTIONS; i++)
+        bytes += (size_t)c->sections[i].meshVertexCount * sizeof(ChunkVertex);
+    return bytes;
+}
+
+// Highest score first: farthest outside the ring and longest unseen.
+static int CompareCandidates(const void* a, const void* b) {
+    uint32_t sa = ((const EvictionCandidate*)a)->score;
+    uint32_t sb = ((const EvictionCandidate*)b)->score;
+    return sa < sb ? 1 : (sa > sb ? -1 : 0);
+}
+
+static void Evict(ChunkCache* cache, ChunkMap* map, Chunk* c) {
+    RegionStore_Save(cache->store, c);
+    UnloadChunk(ChunkMap_Remove(map, c->chunkX, c->chunkZ));
+}
+
+void ChunkCache_Trim(ChunkCache* cache, ChunkMap* map, int centerX, int centerZ, int keepDist) {
+    EvictionCandidate* candidates = (EvictionCandidate*)Memory_Alloc(MEM_TAG_VOXEL, map->count * sizeof(EvictionCandidate));
+    if (!candidates) return;
+    int count = 0;
+
+    cache->voxelBytes = cache->gpuBytes = cache->compressedBytes = 0;
+    cache->residentChunks = cache->compressedChunks = 0;
+    for (int i = 0; i < map->capacity; i++) {
+        Chunk* c = map->entries[i].chunk;
+        if (!c) continue;
+
+        if (c->compressed) {
+            cache->compressedBytes += sizeof(Chunk) + c->compressedSize;
+            cache->compressedChunks++;
+        } else {
+            // A worker owns the blocks of a busy chunk until it completes.
+            cache->voxelBytes += c->busy ? sizeof(Chunk) : ChunkMemoryUsage(c);
+            cache->gpuBytes += ChunkCache_MeshBytes(c);
+            cache->residentChunks++;
+        }
+
+        if (c->inRange || c->busy) continue;
+        int dx = abs(c->chunkX - centerX);
+        int dz = abs(c->chunkZ - centerZ);
+        int dist = dx > dz ? dx : dz;
+        candidates[count++] = (EvictionCandidate){c, (uint32_t)(dist - keepDist) + (cache->tick - c->lastSeen)};
+    }
+    qsort(candidates, count, sizeof(EvictionCandidate), CompareCandidates);
+    double deadline = ChunkClockMs() + CHUNK_CACHE_TRIM_MS;
+
+    // Over either resident budget, demote: drop the mesh and compress the
+    // blocks, which resume the pipeline where they left off once restored.
+    // Chunks that never got their terrain have nothing to keep.
+    for (int i = 0; i < count && (cache->voxelBytes > cache->voxelBudget || cache->gpuBytes > cache->gpuBudget); i++) {
+        Chunk* c = candidates[i].chunk;
+        if (c->compressed) continue;
+        if (ChunkClockMs() >= deadline) break;
+
+        cache->voxelBytes -= ChunkMemoryUsage(c);
+        cache->gpuBytes -= ChunkCache_MeshBytes(c);
+        cache->residentChunks--;
+
+        FreeChunkMesh(c);
+        if (c->state == CHUNK_MESHED) c->state = CHUNK_LIT;
+        if (c->state >= CHUNK_TERRAIN && CompressChunk(c)) {
+            cache->compressedBytes += sizeof(Chunk) + c->compressedSize;
+            cache->compressedChunks++;
+        } else {
+            Evict(cache, map, c);
+            candidates[i].chunk = NULL;
+        }
+    }
+
+    for (int i = 0; i < count && cache->compressedBytes > cache->compressedBudget; i++) {
+        Chunk* c = candidates[i].chunk;
+        if (!c || !c->compressed) continue;
+        if (ChunkClockMs() >= deadline) break;
+
+        cache->compressedBytes -= sizeof(Chunk) + c->compressedSize;
+        cache->compressedChunks--;
+        Evict(cache, map, c);
+    }
+    Memory_Free(MEM_TAG_VOXEL, candidates);
+}
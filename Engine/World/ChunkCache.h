@@ -0,0 +1,37 @@
+#ifndef CHUNKCACHE_H
+#define CHUNKCACHE_H
+#include "Block.h"
+#include "ChunkMap.h"
+#include "RegionStore.h"
+
+// Soft cap on the time one trim spends compressing and evicting; whatever is
+// still over budget waits for the next trim.
+#define CHUNK_CACHE_TRIM_MS 1.0
+
+// Residency policy for chunks that left the load ring. They stay in the map
+// as long as the resident voxel and GPU mesh totals fit their budgets; past
+// that, the least wanted ones drop their mesh and move their blocks into a
+// compressed tier, and past the compressed budget they are written to the
+// region store, if there is one, and freed.
+// "Least wanted" ranks chunks by how many chunks they lie outside the ring
+// plus how many loading updates ago they were last inside it.
+typedef struct ChunkCache {
+    size_t voxelBudget;
+    size_t gpuBudget;
+    size_t compressedBudget;
+    uint32_t tick;
+    RegionStore* store;
+
+    // Totals as of the last trim.
+    size_t voxelBytes;
+    size_t gpuBytes;
+    size_t compressedBytes;
+    int residentChunks;
+    int compressedChunks;
+} ChunkCache;
+
+void ChunkCache_Init(ChunkCache* cache, size_t voxelBudget, size_t gpuBudget, size_t compressedBudget, RegionStore* store);
+void ChunkCache_Trim(ChunkCache* cache, ChunkMap* map, int centerX, int centerZ, int keepDist);
+size_t ChunkCache_MeshBytes(const Chunk* c);
+
+#endif
@@ -0,0 +1,110 @@
+#include "ChunkMap.h"
+#include "../Memory.h"
+
+static uint64_t PackChunkKey(int chunkX, int chunkZ) {
+    return ((uint64_t)(uint32_t)chunkX << 32) | (uint32_t)chunkZ;
+}
+
+static uint64_t HashChunkKey(uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return key;
+}
+
+bool ChunkMap_Init(ChunkMap* map, int capacity) {
+    int cap = 16;
+    while (cap < capacity) cap <<= 1;
+
+    map->entries = (ChunkMapEntry*)Memory_Calloc(MEM_TAG_VOXEL, cap, sizeof(ChunkMapEntry));
+    map->capacity = map->entries ? cap : 0;
+    map->count = 0;
+    map->tombstones = 0;
+    return map->entries != NULL;
+}
+
+void ChunkMap_Free(ChunkMap* map) {
+    Memory_Free(MEM_TAG_VOXEL, map->entries);
+    map->entries = NULL;
+    map->capacity = 0;
+    map->count = 0;
+    map->tombstones = 0;
+}
+
+static int FindSlot(const ChunkMap* map, uint64_t key) {
+    int mask = map->capacity - 1;
+    int i = (int)(HashChunkKey(key) & mask);
+    while (map->entries[i].chunk || map->entries[i].tombstone) {
+        if (map->entries[i].chunk && map->entries[i].key == key) return i;
+        i = (i + 1) & mask;
+    }
+    return -1;
+}
+
+struct Chunk* ChunkMap_Get(const ChunkMap* map, int chunkX, int chunkZ) {
+    if (map->count == 0) return NULL;
+    int i = FindSlot(map, PackChunkKey(chunkX, chunkZ));
+    return i >= 0 ? map->entries[i].chunk : NULL;
+}
+
+static bool Rehash(ChunkMap* map, int capacity) {
+    ChunkMapEntry* old = map->entries;
+    int oldCapacity = map->capacity;
+
+    ChunkMapEntry* entries = (ChunkMapEntry*)Memory_Calloc(MEM_TAG_VOXEL, capacity, sizeof(ChunkMapEntry));
+    if (!entries) return false;
+
+    map->entries = entries;
+    map->capacity = capacity;
+    map->tombstones = 0;
+
+    int mask = capacity - 1;
+    for (int j = 0; j < oldCapacity; j++) {
+        if (!old[j].chunk) continue;
+        int i = (int)(HashChunkKey(old[j].key) & mask);
+        while (entries[i].chunk) i = (i + 1) & mask;
+        entries[i] = old[j];
+    }
+    Memory_Free(MEM_TAG_VOXEL, old);
+    return true;
+}
+
+bool ChunkMap_Insert(ChunkMap* map, int chunkX, int chunkZ, struct Chunk* chunk) {
+    if (!chunk) return false;
+
+    if ((map->count + map->tombstones + 1) * 4 > map->capacity * 3) {
+        int capacity = (map->count + 1) * 2 > map->capacity ? map->capacity * 2 : map->capacity;
+        if (!Rehash(map, capacity)) return false;
+    }
+
+    uint64_t key = PackChunkKey(chunkX, chunkZ);
+    int existing = FindSlot(map, key);
+    if (existing >= 0) {
+        map->entries[existing].chunk = chunk;
+        return true;
+    }
+
+    int mask = map->capacity - 1;
+    int i = (int)(HashChunkKey(key) & mask);
+    while (map->entries[i].chunk) i = (i + 1) & mask;
+
+    if (map->entries[i].tombstone) map->tombstones--;
+    map->entries[i] = (ChunkMapEntry){key, chunkX, chunkZ, chunk, false};
+    map->count++;
+    return true;
+}
+
+struct Chunk* ChunkMap_Remove(ChunkMap* map, int chunkX, int chunkZ) {
+    if (map->count == 0) return NULL;
+    int i = FindSlot(map, PackChunkKey(chunkX, chunkZ));
+    if (i < 0) return NULL;
+
+    struct Chunk* chunk = map->entries[i].chunk;
+    map->entries[i].chunk = NULL;
+    map->entries[i].tombstone = true;
+    map->count--;
+    map->tombstones++;
+    return chunk;
+}
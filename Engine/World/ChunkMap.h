@@ -0,0 +1,32 @@
+#ifndef CHUNKMAP_H
+#define CHUNKMAP_H
+#include <stdbool.h>
+#include <stdint.h>
+
+struct Chunk;
+
+typedef struct {
+    uint64_t key;
+    int chunkX;
+    int chunkZ;
+    struct Chunk* chunk;
+    bool tombstone;
+} ChunkMapEntry;
+
+// Open-addressing (linear probing) hash map from chunk coordinates to chunks.
+// Capacity is a power of two and doubles once the table is 3/4 full.
+// Removal leaves a tombstone, so entries never move while iterating.
+typedef struct ChunkMap {
+    ChunkMapEntry* entries;
+    int capacity;
+    int count;
+    int tombstones;
+} ChunkMap;
+
+bool ChunkMap_Init(ChunkMap* map, int capacity);
+void ChunkMap_Free(ChunkMap* map);
+struct Chunk* ChunkMap_Get(const ChunkMap* map, int chunkX, int chunkZ);
+bool ChunkMap_Insert(ChunkMap* map, int chunkX, int chunkZ, struct Chunk* chunk);
+struct Chunk* ChunkMap_Remove(ChunkMap* map, int chunkX, int chunkZ);
+
+#endif
@@ -0,0 +1,154 @@
+#include "ChunkPool.h"
+#include "../Profiler.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    void* ptr;
+    MemoryTag tag;
+    bool chunk;
+} ReclaimItem;
+
+static pthread_mutex_t g_poolLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_poolWake = PTHREAD_COND_INITIALIZER;
+static pthread_t g_reclaimer;
+static bool g_poolRunning;
+static bool g_poolStopping;
+
+static ReclaimItem* g_pending;
+static int g_pendingCount;
+static int g_pendingCapacity;
+
+static Chunk** g_freeChunks;
+static int g_freeCount;
+static int g_maxFree;
+
+static void FreeChunkBlocks(Chunk* c) {
+    for (int i = 0; i < CHUNK_SECTIONS; i++)
+        BlockStorage_Free(&c->sections[i].blocks);
+    Memory_Free(MEM_TAG_VOXEL, c->compressed);
+}
+
+// Works on a private copy of the pending list so the main thread only ever
+// waits for the swap.
+static void* ReclaimerMain(void* arg) {
+    ReclaimItem* batch = NULL;
+    int batchCapacity = 0;
+    PROFILE_THREAD("Chunk reclaimer");
+
+    pthread_mutex_lock(&g_poolLock);
+    for (;;) {
+        while (g_pendingCount == 0 && !g_poolStopping)
+            pthread_cond_wait(&g_poolWake, &g_poolLock);
+        if (g_pendingCount == 0) break;
+
+        ReclaimItem* items = g_pending;
+        int count = g_pendingCount;
+        int itemsCapacity = g_pendingCapacity;
+        g_pending = batch;
+        g_pendingCapacity = batchCapacity;
+        g_pendingCount = 0;
+        pthread_mutex_unlock(&g_poolLock);
+
+        PROFILE_BEGIN("Reclaim");
+        for (int i = 0; i < count; i++) {
+            if (!items[i].chunk) {
+                Memory_Free(items[i].tag, items[i].ptr);
+                continue;
+            }
+            Chunk* c = (Chunk*)items[i].ptr;
+            FreeChunkBlocks(c);
+            memset(c, 0, sizeof(Chunk));
+
+            pthread_mutex_lock(&g_poolLock);
+            bool kept = g_freeCount < g_maxFree;
+            if (kept) g_freeChunks[g_freeCount++] = c;
+            pthread_mutex_unlock(&g_poolLock);
+            if (!kept) Memory_Free(MEM_TAG_VOXEL, c);
+        }
+        PROFILE_END();
+        batch = items;
+        batchCapacity = itemsCapacity;
+
+        pthread_mutex_lock(&g_poolLock);
+    }
+    pthread_mutex_unlock(&g_poolLock);
+    Memory_Free(MEM_TAG_VOXEL, batch);
+    return NULL;
+}
+
+void ChunkPool_Start(int maxFree) {
+    g_freeChunks = (Chunk**)Memory_Alloc(MEM_TAG_VOXEL, maxFree * sizeof(Chunk*));
+    if (!g_freeChunks) return;
+    g_maxFree = maxFree;
+    g_freeCount = 0;
+    g_poolStopping = false;
+    g_poolRunning = pthread_create(&g_reclaimer, NULL, ReclaimerMain, NULL) == 0;
+    if (!g_poolRunning) {
+        Memory_Free(MEM_TAG_VOXEL, g_freeChunks);
+        g_freeChunks = NULL;
+        g_maxFree = 0;
+    }
+}
+
+// Finishes everything already handed over before returning.
+void ChunkPool_Stop(void) {
+    if (!g_poolRunning) return;
+    pthread_mutex_lock(&g_poolLock);
+    g_poolStopping = true;
+    pthread_cond_signal(&g_poolWake);
+    pthread_mutex_unlock(&g_poolLock);
+    pthread_join(g_reclaimer, NULL);
+
+    g_poolRunning = false;
+    for (int i = 0; i < g_freeCount; i++)
+        Memory_Free(MEM_TAG_VOXEL, g_freeChunks[i]);
+    Memory_Free(MEM_TAG_VOXEL, g_freeChunks);
+    Memory_Free(MEM_TAG_VOXEL, g_pending);
+    g_freeChunks = NULL;
+    g_pending = NULL;
+    g_freeCount = g_maxFree = 0;
+    g_pendingCount = g_pendingCapacity = 0;
+}
+
+// Returns a zeroed chunk.
+Chunk* ChunkPool_Acquire(void) {
+    Chunk* c = NULL;
+    if (g_poolRunning) {
+        pthread_mutex_lock(&g_poolLock);
+        if (g_freeCount > 0) c = g_freeChunks[--g_freeCount];
+        pthread_mutex_unlock(&g_poolLock);
+    }
+    return c ? c : (Chunk*)Memory_Calloc(MEM_TAG_VOXEL, 1, sizeof(Chunk));
+}
+
+static bool Enqueue(void* ptr, MemoryTag tag, bool chunk) {
+    if (!g_poolRunning) return false;
+    pthread_mutex_lock(&g_poolLock);
+    if (g_pendingCount == g_pendingCapacity) {
+        int capacity = g_pendingCapacity ? g_pendingCapacity * 2 : 64;
+        ReclaimItem* grown = (ReclaimItem*)Memory_Realloc(MEM_TAG_VOXEL, g_pending, capacity * sizeof(ReclaimItem));
+        if (!grown) {
+            pthread_mutex_unlock(&g_poolLock);
+            return false;
+        }
+        g_pending = grown;
+        g_pendingCapacity = capacity;
+    }
+    g_pending[g_pendingCount++] = (ReclaimItem){ptr, tag, chunk};
+    pthread_cond_signal(&g_poolWake);
+    pthread_mutex_unlock(&g_poolLock);
+    return true;
+}
+
+void ChunkPool_Release(Chunk* c) {
+    if (c && !Enqueue(c, MEM_TAG_VOXEL, true)) {
+        FreeChunkBlocks(c);
+        Memory_Free(MEM_TAG_VOXEL, c);
+    }
+}
+
+void ChunkPool_Free(MemoryTag tag, void* p) {
+    if (p && !Enqueue(p, tag, false)) Memory_Free(tag, p);
+}
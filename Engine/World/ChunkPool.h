@@ -0,0 +1,18 @@
+#ifndef CHUNKPOOL_H
+#define CHUNKPOOL_H
+#include "Block.h"
+
+// Recycles chunk structs and takes frees off the main thread. Released
+// chunks go to a reclaimer thread, which frees their blocks, clears them and
+// parks up to maxFree of them for AllocateChunk to hand out again. Other
+// buffers the main thread is done with, such as mesh job inputs and vertex
+// data, are freed there too, under the memory tag they were allocated with.
+// Before ChunkPool_Start and after ChunkPool_Stop everything is allocated and
+// freed directly.
+void ChunkPool_Start(int maxFree);
+void ChunkPool_Stop(void);
+Chunk* ChunkPool_Acquire(void);
+void ChunkPool_Release(Chunk* c);
+void ChunkPool_Free(MemoryTag tag, void* p);
+
+#endif
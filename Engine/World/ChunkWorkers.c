@@ -0,0 +1,345 @@
+#include "ChunkWorkers.h"
+#include "ChunkPool.h"
+#include "../Profiler.h"
+#include <math.h>
+#include <sched.h>
+#include <stdlib.h>
+
+static void PushCompleted(ChunkWorkerPool* pool, ChunkResult* result) {
+    ChunkResult* head = atomic_load_explicit(&pool->completed, memory_order_relaxed);
+    do {
+        result->next = head;
+    } while (!atomic_compare_exchange_weak_explicit(&pool->completed, &head, result,
+                                                    memory_order_release, memory_order_relaxed));
+}
+
+static void SiftUp(ChunkJob* heap, int i) {
+    ChunkJob job = heap[i];
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (heap[parent].priority <= job.priority) break;
+        heap[i] = heap[parent];
+        i = parent;
+    }
+    heap[i] = job;
+}
+
+static void SiftDown(ChunkJob* heap, int count, int i) {
+    ChunkJob job = heap[i];
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= count) break;
+        if (child + 1 < count && heap[child + 1].priority < heap[child].priority) child++;
+        if (job.priority <= heap[child].priority) break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = job;
+}
+
+static bool PopRequest(ChunkWorkerPool* pool, ChunkJob* job) {
+    pthread_mutex_lock(&pool->lock);
+    while (pool->queueCount == 0 && !pool->stopping)
+        pthread_cond_wait(&pool->wake, &pool->lock);
+
+    bool found = pool->queueCount > 0;
+    if (found) {
+        *job = pool->queue[0];
+        pool->queue[0] = pool->queue[--pool->queueCount];
+        if (pool->queueCount > 0) SiftDown(pool->queue, pool->queueCount, 0);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return found;
+}
+
+#if PROFILER_ENABLED
+static const char* const g_stageScopes[] = {"Empty", "Terrain", "Carve", "Decorate", "Light", "Mesh"};
+#endif
+
+static void* WorkerMain(void* arg) {
+    ChunkWorkerPool* pool = (ChunkWorkerPool*)arg;
+    ChunkJob job;
+    PROFILE_THREAD("Chunk worker");
+    while (PopRequest(pool, &job)) {
+        ChunkResult* result = job.result;
+        result->chunk = job.chunk;
+        result->stage = job.stage;
+        result->input = job.input;
+
+        PROFILE_BEGIN(g_stageScopes[job.stage]);
+        switch (job.stage) {
+            case CHUNK_TERRAIN:
+                if (pool->store) {
+                    ChunkState stored = RegionStore_Load(pool->store, job.chunk);
+                    if (stored != CHUNK_EMPTY) {
+                        result->stage = stored;
+                        break;
+                    }
+                }
+                GenerateChunkTerrain(job.chunk, pool->chunkSize, pool->voxelSize);
+                break;
+            case CHUNK_CARVED:
+                CarveChunk(job.chunk, pool->chunkSize, pool->voxelSize);
+                break;
+            case CHUNK_DECORATED:
+                DecorateChunk(job.chunk, (const ChunkDecorationInput*)job.input, pool->chunkSize);
+                break;
+            case CHUNK_MESHED: {
+                const ChunkMeshInput* in = (const ChunkMeshInput*)job.input;
+                for (int i = 0; i < in->sectionCount; i++)
+                    GenerateChunkMeshData(&in->neighborhoods[i], pool->chunkSize, pool->voxelSize,
+                                          &result->meshes[in->sections[i]]);
+                break;
+            }
+            default:
+                break;
+        }
+        PROFILE_END();
+
+        PushCompleted(pool, result);
+        atomic_fetch_sub_explicit(&pool->inFlight, 1, memory_order_release);
+    }
+    return NULL;
+}
+
+bool ChunkWorkers_Start(ChunkWorkerPool* pool, int threadCount, int chunkSize, float voxelSize, RegionStore* store) {
+    *pool = (ChunkWorkerPool){0};
+    pool->chunkSize = chunkSize;
+    pool->voxelSize = voxelSize;
+    pool->store = store;
+    pool->queueCapacity = 64;
+    pool->queue = (ChunkJob*)Memory_Alloc(MEM_TAG_VOXEL, pool->queueCapacity * sizeof(ChunkJob));
+    pool->threads = (pthread_t*)Memory_Alloc(MEM_TAG_VOXEL, threadCount * sizeof(pthread_t));
+    if (!pool->queue || !pool->threads) {
+        Memory_Free(MEM_TAG_VOXEL, pool->queue);
+        Memory_Free(MEM_TAG_VOXEL, pool->threads);
+        return false;
+    }
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    atomic_init(&pool->completed, NULL);
+    atomic_init(&pool->inFlight, 0);
+
+    // Resolve the lazily-initialised seed before any worker reads it.
+    GetWorldSeed();
+
+    for (int i = 0; i < threadCount; i++) {
+        if (pthread_create(&pool->threads[i], NULL, WorkerMain, pool) != 0) break;
+        pool->threadCount++;
+    }
+    if (pool->threadCount > 0) return true;
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->wake);
+    Memory_Free(MEM_TAG_VOXEL, pool->queue);
+    Memory_Free(MEM_TAG_VOXEL, pool->threads);
+    *pool = (ChunkWorkerPool){0};
+    return false;
+}
+
+static void FreeResult(ChunkResult* result) {
+    if (result->chunk->cancelled) FreeChunk(result->chunk);
+    // The vertex data is uploaded by now and the snapshots can run to
+    // hundreds of KiB, so both go to the reclaimer.
+    for (int i = 0; i < CHUNK_SECTIONS; i++)
+        ChunkPool_Free(MEM_TAG_MESH_SCRATCH, result->meshes[i].vertices);
+    ChunkPool_Free(ChunkJobInputTag(result->stage), result->input);
+    Memory_Free(MEM_TAG_VOXEL, result);
+}
+
+void ChunkWorkers_Stop(ChunkWorkerPool* pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = true;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < pool->threadCount; i++)
+        pthread_join(pool->threads[i], NULL);
+
+    for (int i = 0; i < pool->queueCount; i++) {
+        ChunkJob* job = &pool->queue[i];
+        if (job->chunk->cancelled) FreeChunk(job->chunk);
+        Memory_Free(ChunkJobInputTag(job->stage), job->input);
+        Memory_Free(MEM_TAG_VOXEL, job->result);
+    }
+
+    ChunkResult* r = atomic_exchange(&pool->completed, NULL);
+    while (r) {
+        ChunkResult* next = r->next;
+        FreeResult(r);
+        r = next;
+    }
+    for (r = pool->readyHead; r; ) {
+        ChunkResult* next = r->next;
+        FreeResult(r);
+        r = next;
+    }
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->wake);
+    Memory_Free(MEM_TAG_VOXEL, pool->queue);
+    Memory_Free(MEM_TAG_VOXEL, pool->threads);
+    *pool = (ChunkWorkerPool){0};
+}
+
+static bool GrowQueue(ChunkWorkerPool* pool, int needed) {
+    if (needed <= pool->queueCapacity) return true;
+    int capacity = pool->queueCapacity;
+    while (capacity < needed) capacity *= 2;
+    ChunkJob* queue = (ChunkJob*)Memory_Realloc(MEM_TAG_VOXEL, pool->queue, capacity * sizeof(ChunkJob));
+    if (!queue) return false;
+    pool->queue = queue;
+    pool->queueCapacity = capacity;
+    return true;
+}
+
+static void FreeResultList(ChunkResult* r) {
+    while (r) {
+        ChunkResult* next = r->next;
+        Memory_Free(MEM_TAG_VOXEL, r);
+        r = next;
+    }
+}
+
+// Queues the whole batch under one lock and wakes the workers once.
+bool ChunkWorkers_SubmitBatch(ChunkWorkerPool* pool, const ChunkJob* jobs, int count) {
+    if (count <= 0) return true;
+    ChunkResult* results = NULL;
+    for (int i = 0; i < count; i++) {
+        ChunkResult* r = (ChunkResult*)Memory_Calloc(MEM_TAG_VOXEL, 1, sizeof(ChunkResult));
+        if (!r) {
+            FreeResultList(results);
+            return false;
+        }
+        r->next = results;
+        results = r;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    if (!GrowQueue(pool, pool->queueCount + count)) {
+        pthread_mutex_unlock(&pool->lock);
+        FreeResultList(results);
+        return false;
+    }
+    for (int i = 0; i < count; i++) {
+        ChunkJob* job = &pool->queue[pool->queueCount];
+        *job = jobs[i];
+        job->priority = job->chunk->priority;
+        job->result = results;
+        results = results->next;
+        job->result->next = NULL;
+        job->chunk->busy = true;
+        SiftUp(pool->queue, pool->queueCount++);
+    }
+    atomic_fetch_add_explicit(&pool->inFlight, count, memory_order_relaxed);
+    if (count == 1) pthread_cond_signal(&pool->wake);
+    else pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+    return true;
+}
+
+bool ChunkWorkers_Submit(ChunkWorkerPool* pool, Chunk* chunk, ChunkState stage, void* input) {
+    ChunkJob job = {chunk, stage, input};
+    return ChunkWorkers_SubmitBatch(pool, &job, 1);
+}
+
+// Drops queued jobs for chunks that left the load ring or were unloaded
+// before any worker starts them, and reorders the rest by the chunks'
+// current priorities. Main thread only.
+void ChunkWorkers_Reprioritize(ChunkWorkerPool* pool) {
+    int dropped = 0;
+    pthread_mutex_lock(&pool->lock);
+    int kept = 0;
+    for (int i = 0; i < pool->queueCount; i++) {
+        ChunkJob job = pool->queue[i];
+        if (job.chunk->cancelled || !job.chunk->inRange) {
+            ChunkPool_Free(ChunkJobInputTag(job.stage), job.input);
+            Memory_Free(MEM_TAG_VOXEL, job.result);
+            if (job.chunk->cancelled) FreeChunk(job.chunk);
+            else job.chunk->busy = false;
+            dropped++;
+            continue;
+        }
+        job.priority = job.chunk->priority;
+        pool->queue[kept++] = job;
+    }
+    pool->queueCount = kept;
+    for (int i = kept / 2 - 1; i >= 0; i--)
+        SiftDown(pool->queue, kept, i);
+    pthread_mutex_unlock(&pool->lock);
+    atomic_fetch_sub_explicit(&pool->inFlight, dropped, memory_order_relaxed);
+}
+
+// Applies finished jobs, then queues whatever is ready to run next, for about
+// budgetMs of main-thread time in all. Mesh uploads and the snapshots new
+// jobs need are what cost; at least one of each is done per call so loading
+// never stalls. Any finished stage may unblock neighbours, so the pipeline is
+// advanced after the results are applied.
+int ChunkWorkers_ProcessCompleted(ChunkWorkerPool* pool, ChunkMap* map, double budgetMs) {
+    double deadline = ChunkClockMs() + budgetMs;
+    // The stack comes out newest-first; reverse it onto the FIFO ready list.
+    ChunkResult* r = atomic_exchange_explicit(&pool->completed, NULL, memory_order_acquire);
+    ChunkResult* reversed = NULL;
+    while (r) {
+        ChunkResult* next = r->next;
+        r->next = reversed;
+        reversed = r;
+        r = next;
+    }
+    if (reversed) {
+        if (pool->readyTail) pool->readyTail->next = reversed;
+        else pool->readyHead = reversed;
+        for (pool->readyTail = reversed; pool->readyTail->next; pool->readyTail = pool->readyTail->next);
+    }
+
+    int uploads = 0;
+    while (pool->readyHead) {
+        if (uploads > 0 && ChunkClockMs() >= deadline) break;
+        ChunkResult* result = pool->readyHead;
+        pool->readyHead = result->next;
+        if (!pool->readyHead) pool->readyTail = NULL;
+
+        Chunk* c = result->chunk;
+        if (c->cancelled) {
+            FreeResult(result);
+            continue;
+        }
+
+        c->busy = false;
+        if (result->stage != CHUNK_MESHED) {
+            if (result->stage == CHUNK_DECORATED) pool->generatedChunks++;
+            c->state = result->stage;
+        } else {
+            // Sections the job skipped come back empty, which drops any
+            // mesh they had before.
+            for (int i = 0; i < CHUNK_SECTIONS; i++)
+                UploadChunkMesh(&c->sections[i], &result->meshes[i]);
+            c->state = CHUNK_MESHED;
+            uploads++;
+            pool->meshedChunks++;
+            if (c->dirty) {
+                c->dirty = false;
+                RequestChunkRemesh(map, pool, c);
+            }
+        }
+        FreeResult(result);
+    }
+    AdvanceChunkPipeline(map, pool, deadline);
+    return uploads;
+}
+
+void ChunkWorkers_WaitIdle(ChunkWorkerPool* pool) {
+    while (atomic_load_explicit(&pool->inFlight, memory_order_acquire) > 0)
+        sched_yield();
+}
+
+// Runs every pipeline stage to completion, including the jobs each finished
+// stage unblocks.
+void ChunkWorkers_Flush(ChunkWorkerPool* pool, ChunkMap* map) {
+    do {
+        ChunkWorkers_WaitIdle(pool);
+        ChunkWorkers_ProcessCompleted(pool, map, INFINITY);
+    } while (atomic_load_explicit(&pool->inFlight, memory_order_acquire) > 0 ||
+             atomic_load_explicit(&pool->completed, memory_order_acquire) || pool->readyHead);
+}
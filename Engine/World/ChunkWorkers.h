@@ -0,0 +1,75 @@
+#ifndef CHUNKWORKERS_H
+#define CHUNKWORKERS_H
+#include "Block.h"
+#include "RegionStore.h"
+#include "../Renderer.h"
+#include <pthread.h>
+#include <stdatomic.h>
+
+// Runs one pipeline stage on a chunk. input is owned by the job: a
+// ChunkDecorationInput for CHUNK_DECORATED, a ChunkMeshInput for
+// CHUNK_MESHED, NULL otherwise. priority is copied from the chunk when
+// the job is queued and refreshed by ChunkWorkers_Reprioritize. result is
+// allocated when the job is queued, so a worker never has to allocate.
+typedef struct {
+    Chunk* chunk;
+    ChunkState stage;
+    void* input;
+    float priority;
+    struct ChunkResult* result;
+} ChunkJob;
+
+// stage is the stage the chunk reached, which for a CHUNK_TERRAIN job is a
+// later one when the chunk was restored from the region store.
+typedef struct ChunkResult {
+    Chunk* chunk;
+    ChunkState stage;
+    void* input;
+    ChunkMeshData meshes[CHUNK_SECTIONS];
+    struct ChunkResult* next;
+} ChunkResult;
+
+// Fixed-size thread pool that runs the generation stages and CPU-side meshing.
+// Stages that depend on neighbours work on snapshots taken on the main thread,
+// so workers never read neighbouring chunks directly.
+// Requests go through a mutex-protected min-heap on priority; finished chunks
+// are pushed onto a lock-free stack that the main thread drains within a time
+// budget per frame. Only the main thread touches GL or the chunk map.
+typedef struct ChunkWorkerPool {
+    pthread_t* threads;
+    int threadCount;
+    int chunkSize;
+    float voxelSize;
+    RegionStore* store;
+
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    ChunkJob* queue;
+    int queueCount;
+    int queueCapacity;
+    bool stopping;
+
+    _Atomic(ChunkResult*) completed;
+    atomic_int inFlight;
+
+    ChunkResult* readyHead;
+    ChunkResult* readyTail;
+
+    // Results applied so far: chunks that finished generating (decoration
+    // being the last worker stage) and mesh uploads, remeshes included.
+    long generatedChunks;
+    long meshedChunks;
+} ChunkWorkerPool;
+
+bool ChunkWorkers_Start(ChunkWorkerPool* pool, int threadCount, int chunkSize, float voxelSize, RegionStore* store);
+void ChunkWorkers_Stop(ChunkWorkerPool* pool);
+// Both return false without queuing anything if memory runs out. The inputs
+// then still belong to the caller, and the chunks stay idle.
+bool ChunkWorkers_Submit(ChunkWorkerPool* pool, Chunk* chunk, ChunkState stage, void* input);
+bool ChunkWorkers_SubmitBatch(ChunkWorkerPool* pool, const ChunkJob* jobs, int count);
+void ChunkWorkers_Reprioritize(ChunkWorkerPool* pool);
+int ChunkWorkers_ProcessCompleted(ChunkWorkerPool* pool, ChunkMap* map, double budgetMs);
+void ChunkWorkers_WaitIdle(ChunkWorkerPool* pool);
+void ChunkWorkers_Flush(ChunkWorkerPool* pool, ChunkMap* map);
+
+#endif
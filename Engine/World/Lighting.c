@@ -2,15 +2,10 @@
 #include <GL/glew.h>
 #include <stdio.h>
 
-void SetDirectionalLightUniforms(const DirectionalLight* light, unsigned int shaderID, vec3 viewPos) {
-    glUniform3f(glGetUniformLocation(shaderID, "dirLight.direction"),
-                light->direction.x, light->direction.y, light->direction.z);
-    glUniform3f(glGetUniformLocation(shaderID, "dirLight.color"),
-                light->color.x, light->color.y, light->color.z);
-    glUniform1f(glGetUniformLocation(shaderID, "dirLight.ambient"), light->ambient);
-    glUniform1f(glGetUniformLocation(shaderID, "dirLight.diffuse"), light->diffuse);
-    glUniform1f(glGetUniformLocation(shaderID, "dirLight.specular"), light->specular);
-    glUniform3f(glGetUniformLocation(shaderID, "viewPos"), viewPos.x, viewPos.y, viewPos.z);
+void SetDirectionalLightUniforms(const DirectionalLight* light, FrameUniforms* frame) {
+    frame->lightDirection = (vec4){light->direction.x, light->direction.y, light->direction.z, 0.0f};
+    frame->lightColor = (vec4){light->color.x, light->color.y, light->color.z, 0.0f};
+    frame->lightParams = (vec4){light->ambient, light->diffuse, light->specular, 0.0f};
 }
 
 float CalculateAO(int side1, int side2, int corner) {
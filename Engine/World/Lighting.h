@@ -1,5 +1,6 @@
 #ifndef LIGHTING_H
 #define LIGHTING_H
+#include "../Shaderer.h"
 #include "../utils/MathUtil.h"
 
 typedef struct {
@@ -10,7 +11,7 @@ typedef struct {
     float specular;
 } DirectionalLight;
 
-void SetDirectionalLightUniforms(const DirectionalLight* light, unsigned int shaderID, vec3 viewPos);
+void SetDirectionalLightUniforms(const DirectionalLight* light, FrameUniforms* frame);
 float CalculateAO(int side1, int side2, int corner);
 
 #endif
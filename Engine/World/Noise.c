@@ -0,0 +1,383 @@
+#include "Noise.h"
+#include <math.h>
+#include <stdatomic.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define NOISE_X86 1
+#endif
+
+static int hash(int x, int y, int seed) {
+    int h = seed;
+    h = (h ^ x) * 0x27d4eb2d;
+    h = (h ^ y) * 0x27d4eb2d;
+    h = (h ^ (h >> 15)) * 0x27d4eb2d;
+    return h;
+}
+
+static float smoothstep(float t) {
+    return t * t * (3.0f - 2.0f * t);
+}
+
+static float lerp(float a, float b, float t) {
+    return a + t * (b - a);
+}
+
+static float gradient(int hash, float x, float y) {
+    int h = hash & 7;
+    float u = h < 4 ? x : y;
+    float v = h < 4 ? y : x;
+    return ((h & 1) ? -u : u) + ((h & 2) ? -v : v);
+}
+
+float perlinNoise2D(float x, float y, int seed) {
+    int x0 = (int)floorf(x);
+    int y0 = (int)floorf(y);
+    int x1 = x0 + 1;
+    int y1 = y0 + 1;
+
+    float sx = x - (float)x0;
+    float sy = y - (float)y0;
+
+    float n00 = gradient(hash(x0, y0, seed), sx, sy);
+    float n10 = gradient(hash(x1, y0, seed), sx - 1.0f, sy);
+    float n01 = gradient(hash(x0, y1, seed), sx, sy - 1.0f);
+    float n11 = gradient(hash(x1, y1, seed), sx - 1.0f, sy - 1.0f);
+
+    float u = smoothstep(sx);
+    float v = smoothstep(sy);
+
+    float nx0 = lerp(n00, n10, u);
+    float nx1 = lerp(n01, n11, u);
+
+    return lerp(nx0, nx1, v);
+}
+
+float perlinNoise(float x, float z, int seed, int octaves, float persistence) {
+    float total = 0.0f;
+    float frequency = 1.0f;
+    float amplitude = 1.0f;
+    float maxValue = 0.0f;
+
+    for (int i = 0; i < octaves; i++) {
+        total += perlinNoise2D(x * frequency, z * frequency, seed + i) * amplitude;
+
+        maxValue += amplitude;
+        amplitude *= persistence;
+        frequency *= 2.0f;
+    }
+
+    return total / maxValue;
+}
+
+static uint64_t MixRandom(uint64_t h) {
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+uint32_t Noise_Random(int seed, int x, int y, int z, NoisePurpose purpose) {
+    uint64_t h = MixRandom((uint64_t)(uint32_t)seed + 0x9e3779b97f4a7c15ULL);
+    h = MixRandom(h ^ (uint32_t)purpose);
+    h = MixRandom(h ^ (uint32_t)x);
+    h = MixRandom(h ^ (uint32_t)y);
+    h = MixRandom(h ^ (uint32_t)z);
+    return (uint32_t)(h >> 32);
+}
+
+float Noise_RandomUnit(int seed, int x, int y, int z, NoisePurpose purpose) {
+    return (Noise_Random(seed, x, y, z, purpose) >> 8) * (1.0f / 16777216.0f);
+}
+
+static int hash3(int x, int y, int z, int seed) {
+    int h = seed;
+    h = (h ^ x) * 0x27d4eb2d;
+    h = (h ^ y) * 0x27d4eb2d;
+    h = (h ^ z) * 0x27d4eb2d;
+    h = (h ^ (h >> 15)) * 0x27d4eb2d;
+    return h;
+}
+
+static float fade(float t) {
+    return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+}
+
+// Dot product with one of the 12 cube-edge gradients.
+static float gradient3(int hash, float x, float y, float z) {
+    int h = hash & 15;
+    float u = h < 8 ? x : y;
+    float v = h < 4 ? y : (h == 12 || h == 14 ? x : z);
+    return ((h & 1) ? -u : u) + ((h & 2) ? -v : v);
+}
+
+float perlinNoise3D(float x, float y, float z, int seed) {
+    int x0 = (int)floorf(x);
+    int y0 = (int)floorf(y);
+    int z0 = (int)floorf(z);
+
+    float sx = x - (float)x0;
+    float sy = y - (float)y0;
+    float sz = z - (float)z0;
+
+    float n000 = gradient3(hash3(x0, y0, z0, seed), sx, sy, sz);
+    float n100 = gradient3(hash3(x0 + 1, y0, z0, seed), sx - 1.0f, sy, sz);
+    float n010 = gradient3(hash3(x0, y0 + 1, z0, seed), sx, sy - 1.0f, sz);
+    float n110 = gradient3(hash3(x0 + 1, y0 + 1, z0, seed), sx - 1.0f, sy - 1.0f, sz);
+    float n001 = gradient3(hash3(x0, y0, z0 + 1, seed), sx, sy, sz - 1.0f);
+    float n101 = gradient3(hash3(x0 + 1, y0, z0 + 1, seed), sx - 1.0f, sy, sz - 1.0f);
+    float n011 = gradient3(hash3(x0, y0 + 1, z0 + 1, seed), sx, sy - 1.0f, sz - 1.0f);
+    float n111 = gradient3(hash3(x0 + 1, y0 + 1, z0 + 1, seed), sx - 1.0f, sy - 1.0f, sz - 1.0f);
+
+    float u = fade(sx);
+    float v = fade(sy);
+    float w = fade(sz);
+
+    float nx00 = lerp(n000, n100, u);
+    float nx10 = lerp(n010, n110, u);
+    float nx01 = lerp(n001, n101, u);
+    float nx11 = lerp(n011, n111, u);
+
+    return lerp(lerp(nx00, nx10, v), lerp(nx01, nx11, v), w);
+}
+
+void Noise_Perlin3DLattice(float x0, float y0, float z0, float step, int nx, int ny, int nz,
+                           float frequency, int seed, float* out) {
+    for (int j = 0; j < ny; j++)
+        for (int k = 0; k < nz; k++)
+            for (int i = 0; i < nx; i++)
+                *out++ = perlinNoise3D((x0 + i * step) * frequency, (y0 + j * step) * frequency,
+                                       (z0 + k * step) * frequency, seed);
+}
+
+void Noise_LatticeLayer(const float* lattice, int nx, int nz, int cell, int y, float* out) {
+    int j = y / cell;
+    float ty = (float)(y - j * cell) / cell;
+    const float* below = lattice + j * nz * nx;
+    const float* above = below + nz * nx;
+    int width = (nx - 1) * cell;
+
+    float plane[nz * nx];
+    for (int i = 0; i < nz * nx; i++)
+        plane[i] = below[i] + ty * (above[i] - below[i]);
+
+    float weights[cell];
+    for (int t = 0; t < cell; t++)
+        weights[t] = (float)t / cell;
+
+    for (int z = 0; z < (nz - 1) * cell; z++) {
+        int k = z / cell;
+        float tz = (float)(z - k * cell) / cell;
+        float row[nx];
+        for (int i = 0; i < nx; i++)
+            row[i] = plane[k * nx + i] + tz * (plane[(k + 1) * nx + i] - plane[k * nx + i]);
+
+        float* dst = out + z * width;
+        for (int i = 0; i < nx - 1; i++) {
+            int t = 0;
+#ifdef NOISE_X86
+            // Every group of four voxels shares the same two lattice values.
+            __m128 a = _mm_set1_ps(row[i]);
+            __m128 d = _mm_set1_ps(row[i + 1] - row[i]);
+            for (; t + 4 <= cell; t += 4)
+                _mm_storeu_ps(dst + i * cell + t, _mm_add_ps(a, _mm_mul_ps(_mm_loadu_ps(weights + t), d)));
+#endif
+            for (; t < cell; t++)
+                dst[i * cell + t] = row[i] + weights[t] * (row[i + 1] - row[i]);
+        }
+    }
+}
+
+// The vector kernels repeat the scalar arithmetic operation for operation
+// (no FMA, same association) so their results match bit for bit.
+#ifdef NOISE_X86
+__attribute__((target("sse4.1")))
+static __m128i HashSSE41(__m128i x, __m128i y, __m128i seed) {
+    const __m128i k = _mm_set1_epi32(0x27d4eb2d);
+    __m128i h = _mm_mullo_epi32(_mm_xor_si128(seed, x), k);
+    h = _mm_mullo_epi32(_mm_xor_si128(h, y), k);
+    return _mm_mullo_epi32(_mm_xor_si128(h, _mm_srai_epi32(h, 15)), k);
+}
+
+__attribute__((target("sse4.1")))
+static __m128 GradientSSE41(__m128i h, __m128 x, __m128 y) {
+    __m128 useX = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(h, _mm_set1_epi32(4)), _mm_setzero_si128()));
+    __m128 u = _mm_blendv_ps(y, x, useX);
+    __m128 v = _mm_blendv_ps(x, y, useX);
+    u = _mm_xor_ps(u, _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(1)), 31)));
+    v = _mm_xor_ps(v, _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(2)), 30)));
+    return _mm_add_ps(u, v);
+}
+
+__attribute__((target("sse4.1")))
+static __m128 PerlinNoise2DSSE41(__m128 x, __m128 y, __m128i seed) {
+    const __m128 one = _mm_set1_ps(1.0f);
+    __m128i x0 = _mm_cvttps_epi32(_mm_floor_ps(x));
+    __m128i y0 = _mm_cvttps_epi32(_mm_floor_ps(y));
+    __m128i x1 = _mm_add_epi32(x0, _mm_set1_epi32(1));
+    __m128i y1 = _mm_add_epi32(y0, _mm_set1_epi32(1));
+
+    __m128 sx = _mm_sub_ps(x, _mm_cvtepi32_ps(x0));
+    __m128 sy = _mm_sub_ps(y, _mm_cvtepi32_ps(y0));
+    __m128 sx1 = _mm_sub_ps(sx, one);
+    __m128 sy1 = _mm_sub_ps(sy, one);
+
+    __m128 n00 = GradientSSE41(HashSSE41(x0, y0, seed), sx, sy);
+    __m128 n10 = GradientSSE41(HashSSE41(x1, y0, seed), sx1, sy);
+    __m128 n01 = GradientSSE41(HashSSE41(x0, y1, seed), sx, sy1);
+    __m128 n11 = GradientSSE41(HashSSE41(x1, y1, seed), sx1, sy1);
+
+    const __m128 two = _mm_set1_ps(2.0f), three = _mm_set1_ps(3.0f);
+    __m128 u = _mm_mul_ps(_mm_mul_ps(sx, sx), _mm_sub_ps(three, _mm_mul_ps(two, sx)));
+    __m128 v = _mm_mul_ps(_mm_mul_ps(sy, sy), _mm_sub_ps(three, _mm_mul_ps(two, sy)));
+
+    __m128 nx0 = _mm_add_ps(n00, _mm_mul_ps(u, _mm_sub_ps(n10, n00)));
+    __m128 nx1 = _mm_add_ps(n01, _mm_mul_ps(u, _mm_sub_ps(n11, n01)));
+    return _mm_add_ps(nx0, _mm_mul_ps(v, _mm_sub_ps(nx1, nx0)));
+}
+
+__attribute__((target("sse4.1")))
+static int PerlinBatchSSE41(const float* xs, const float* zs, int count, float scale,
+                            int seed, int octaves, float persistence, float* out) {
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 x = _mm_mul_ps(_mm_loadu_ps(xs + i), _mm_set1_ps(scale));
+        __m128 z = _mm_mul_ps(_mm_loadu_ps(zs + i), _mm_set1_ps(scale));
+        __m128 total = _mm_setzero_ps();
+        float frequency = 1.0f, amplitude = 1.0f, maxValue = 0.0f;
+
+        for (int o = 0; o < octaves; o++) {
+            __m128 f = _mm_set1_ps(frequency);
+            __m128 n = PerlinNoise2DSSE41(_mm_mul_ps(x, f), _mm_mul_ps(z, f), _mm_set1_epi32(seed + o));
+            total = _mm_add_ps(total, _mm_mul_ps(n, _mm_set1_ps(amplitude)));
+
+            maxValue += amplitude;
+            amplitude *= persistence;
+            frequency *= 2.0f;
+        }
+        _mm_storeu_ps(out + i, _mm_div_ps(total, _mm_set1_ps(maxValue)));
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static __m256i HashAVX2(__m256i x, __m256i y, __m256i seed) {
+    const __m256i k = _mm256_set1_epi32(0x27d4eb2d);
+    __m256i h = _mm256_mullo_epi32(_mm256_xor_si256(seed, x), k);
+    h = _mm256_mullo_epi32(_mm256_xor_si256(h, y), k);
+    return _mm256_mullo_epi32(_mm256_xor_si256(h, _mm256_srai_epi32(h, 15)), k);
+}
+
+__attribute__((target("avx2")))
+static __m256 GradientAVX2(__m256i h, __m256 x, __m256 y) {
+    __m256 useX = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(h, _mm256_set1_epi32(4)), _mm256_setzero_si256()));
+    __m256 u = _mm256_blendv_ps(y, x, useX);
+    __m256 v = _mm256_blendv_ps(x, y, useX);
+    u = _mm256_xor_ps(u, _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(h, _mm256_set1_epi32(1)), 31)));
+    v = _mm256_xor_ps(v, _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(h, _mm256_set1_epi32(2)), 30)));
+    return _mm256_add_ps(u, v);
+}
+
+__attribute__((target("avx2")))
+static __m256 PerlinNoise2DAVX2(__m256 x, __m256 y, __m256i seed) {
+    const __m256 one = _mm256_set1_ps(1.0f);
+    __m256i x0 = _mm256_cvttps_epi32(_mm256_floor_ps(x));
+    __m256i y0 = _mm256_cvttps_epi32(_mm256_floor_ps(y));
+    __m256i x1 = _mm256_add_epi32(x0, _mm256_set1_epi32(1));
+    __m256i y1 = _mm256_add_epi32(y0, _mm256_set1_epi32(1));
+
+    __m256 sx = _mm256_sub_ps(x, _mm256_cvtepi32_ps(x0));
+    __m256 sy = _mm256_sub_ps(y, _mm256_cvtepi32_ps(y0));
+    __m256 sx1 = _mm256_sub_ps(sx, one);
+    __m256 sy1 = _mm256_sub_ps(sy, one);
+
+    __m256 n00 = GradientAVX2(HashAVX2(x0, y0, seed), sx, sy);
+    __m256 n10 = GradientAVX2(HashAVX2(x1, y0, seed), sx1, sy);
+    __m256 n01 = GradientAVX2(HashAVX2(x0, y1, seed), sx, sy1);
+    __m256 n11 = GradientAVX2(HashAVX2(x1, y1, seed), sx1, sy1);
+
+    const __m256 two = _mm256_set1_ps(2.0f), three = _mm256_set1_ps(3.0f);
+    __m256 u = _mm256_mul_ps(_mm256_mul_ps(sx, sx), _mm256_sub_ps(three, _mm256_mul_ps(two, sx)));
+    __m256 v = _mm256_mul_ps(_mm256_mul_ps(sy, sy), _mm256_sub_ps(three, _mm256_mul_ps(two, sy)));
+
+    __m256 nx0 = _mm256_add_ps(n00, _mm256_mul_ps(u, _mm256_sub_ps(n10, n00)));
+    __m256 nx1 = _mm256_add_ps(n01, _mm256_mul_ps(u, _mm256_sub_ps(n11, n01)));
+    return _mm256_add_ps(nx0, _mm256_mul_ps(v, _mm256_sub_ps(nx1, nx0)));
+}
+
+__attribute__((target("avx2")))
+static int PerlinBatchAVX2(const float* xs, const float* zs, int count, float scale,
+                           int seed, int octaves, float persistence, float* out) {
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 x = _mm256_mul_ps(_mm256_loadu_ps(xs + i), _mm256_set1_ps(scale));
+        __m256 z = _mm256_mul_ps(_mm256_loadu_ps(zs + i), _mm256_set1_ps(scale));
+        __m256 total = _mm256_setzero_ps();
+        float frequency = 1.0f, amplitude = 1.0f, maxValue = 0.0f;
+
+        for (int o = 0; o < octaves; o++) {
+            __m256 f = _mm256_set1_ps(frequency);
+            __m256 n = PerlinNoise2DAVX2(_mm256_mul_ps(x, f), _mm256_mul_ps(z, f), _mm256_set1_epi32(seed + o));
+            total = _mm256_add_ps(total, _mm256_mul_ps(n, _mm256_set1_ps(amplitude)));
+
+            maxValue += amplitude;
+            amplitude *= persistence;
+            frequency *= 2.0f;
+        }
+        _mm256_storeu_ps(out + i, _mm256_div_ps(total, _mm256_set1_ps(maxValue)));
+    }
+    return i;
+}
+#endif
+
+static atomic_int g_noiseBackend = -1;
+
+static NoiseBackend SupportedBackend(NoiseBackend wanted) {
+#ifdef NOISE_X86
+    __builtin_cpu_init();
+    if (wanted >= NOISE_BACKEND_AVX2 && __builtin_cpu_supports("avx2")) return NOISE_BACKEND_AVX2;
+    if (wanted >= NOISE_BACKEND_SSE41 && __builtin_cpu_supports("sse4.1")) return NOISE_BACKEND_SSE41;
+#endif
+    return NOISE_BACKEND_SCALAR;
+}
+
+void Noise_SetBackend(NoiseBackend backend) {
+    atomic_store(&g_noiseBackend, SupportedBackend(backend));
+}
+
+NoiseBackend Noise_GetBackend(void) {
+    int backend = atomic_load(&g_noiseBackend);
+    if (backend < 0) {
+        backend = SupportedBackend(NOISE_BACKEND_AVX2);
+        atomic_store(&g_noiseBackend, backend);
+    }
+    return (NoiseBackend)backend;
+}
+
+const char* Noise_BackendName(NoiseBackend backend) {
+    switch (backend) {
+        case NOISE_BACKEND_AVX2: return "avx2";
+        case NOISE_BACKEND_SSE41: return "sse4.1";
+        default: return "scalar";
+    }
+}
+
+void Noise_PerlinBatch(const float* xs, const float* zs, int count, float scale,
+                       int seed, int octaves, float persistence, float* out) {
+    int done = 0;
+#ifdef NOISE_X86
+    switch (Noise_GetBackend()) {
+        case NOISE_BACKEND_AVX2:
+            done = PerlinBatchAVX2(xs, zs, count, scale, seed, octaves, persistence, out);
+            break;
+        case NOISE_BACKEND_SSE41:
+            done = PerlinBatchSSE41(xs, zs, count, scale, seed, octaves, persistence, out);
+            break;
+        default:
+            break;
+    }
+#endif
+    for (int i = done; i < count; i++)
+        out[i] = perlinNoise(xs[i] * scale, zs[i] * scale, seed, octaves, persistence);
+}
@@ -0,0 +1,47 @@
+#ifndef NOISE_H
+#define NOISE_H
+#include <stdint.h>
+
+typedef enum {
+    NOISE_BACKEND_SCALAR,
+    NOISE_BACKEND_SSE41,
+    NOISE_BACKEND_AVX2
+} NoiseBackend;
+
+float perlinNoise2D(float x, float y, int seed);
+float perlinNoise(float x, float z, int seed, int octaves, float persistence);
+float perlinNoise3D(float x, float y, float z, int seed);
+
+// Every random decision in world generation names its own purpose, so adding
+// a new one never shifts the values an existing one sees.
+typedef enum {
+    NOISE_PURPOSE_TREE,
+    NOISE_PURPOSE_TREE_HEIGHT
+} NoisePurpose;
+
+// Counter-based randomness: a pure hash of (seed, world coordinate, purpose).
+// The result never depends on generation order or on which thread asks.
+uint32_t Noise_Random(int seed, int x, int y, int z, NoisePurpose purpose);
+float Noise_RandomUnit(int seed, int x, int y, int z, NoisePurpose purpose);
+
+// Evaluates out[i] = perlinNoise(xs[i] * scale, zs[i] * scale, ...) for
+// count samples. Every backend is bit-identical to the scalar function.
+void Noise_PerlinBatch(const float* xs, const float* zs, int count, float scale,
+                       int seed, int octaves, float persistence, float* out);
+
+// Samples perlinNoise3D at ((x0 + i*step) * frequency, ...) on an nx*ny*nz
+// lattice, stored [j][k][i].
+void Noise_Perlin3DLattice(float x0, float y0, float z0, float step, int nx, int ny, int nz,
+                           float frequency, int seed, float* out);
+
+// Trilinearly interpolates voxel layer y of a lattice with `cell` voxels
+// between points, writing a (nz-1)*cell by (nx-1)*cell slice stored [z][x].
+void Noise_LatticeLayer(const float* lattice, int nx, int nz, int cell, int y, float* out);
+
+// The backend is picked from CPU features on first use. Requesting one the
+// CPU lacks falls back to the best supported one below it.
+void Noise_SetBackend(NoiseBackend backend);
+NoiseBackend Noise_GetBackend(void);
+const char* Noise_BackendName(NoiseBackend backend);
+
+#endif
@@ -0,0 +1,370 @@
+#include "RegionStore.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define REGION_MAGIC 0x47525856u
+#define REGION_VERSION 1
+#define REGION_HEADER_SECTORS ((uint32_t)((sizeof(RegionHeader) + REGION_SECTOR - 1) / REGION_SECTOR))
+
+static uint32_t crcTable[256];
+
+static void InitCrcTable(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++)
+            c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+        crcTable[i] = c;
+    }
+}
+
+static uint32_t Crc32(const uint8_t* data, size_t size) {
+    uint32_t c = 0xffffffffu;
+    for (size_t i = 0; i < size; i++)
+        c = crcTable[(c ^ data[i]) & 0xff] ^ (c >> 8);
+    return c ^ 0xffffffffu;
+}
+
+static int RegionCoord(int chunk) {
+    return chunk >= 0 ? chunk / REGION_SIZE : (chunk + 1) / REGION_SIZE - 1;
+}
+
+static int EntryIndex(int chunkX, int chunkZ) {
+    return (chunkZ & (REGION_SIZE - 1)) * REGION_SIZE + (chunkX & (REGION_SIZE - 1));
+}
+
+static uint32_t SectorsFor(size_t size) {
+    return (uint32_t)((size + REGION_SECTOR - 1) / REGION_SECTOR);
+}
+
+// Maps the first size bytes of the file, keeping the old mapping on failure.
+static bool MapRegion(Region* r, size_t size) {
+    void* mapped = mmap(NULL, size, PROT_READ, MAP_SHARED, r->fd, 0);
+    if (mapped == MAP_FAILED) return false;
+    if (r->mapped) munmap(r->mapped, r->mappedSize);
+    r->mapped = (uint8_t*)mapped;
+    r->mappedSize = size;
+    return true;
+}
+
+static bool GrowSectors(Region* r, uint32_t count) {
+    if (count <= r->sectorCount) return true;
+    uint8_t* used = (uint8_t*)Memory_Realloc(MEM_TAG_VOXEL, r->sectorUsed, count);
+    if (!used) return false;
+    memset(used + r->sectorCount, 0, count - r->sectorCount);
+    r->sectorUsed = used;
+    r->sectorCount = count;
+    return true;
+}
+
+// First fit over the free sectors, else appended to the file. 0 on failure,
+// since sector 0 always belongs to the header.
+static uint32_t AllocateSectors(Region* r, uint32_t count) {
+    uint32_t run = 0;
+    for (uint32_t i = REGION_HEADER_SECTORS; i < r->sectorCount; i++) {
+        run = r->sectorUsed[i] ? 0 : run + 1;
+        if (run == count) {
+            memset(r->sectorUsed + i + 1 - count, 1, count);
+            return i + 1 - count;
+        }
+    }
+    uint32_t first = r->sectorCount - run;
+    if (!GrowSectors(r, first + count)) return 0;
+    memset(r->sectorUsed + first, 1, count);
+    return first;
+}
+
+static void CloseRegion(Region* r) {
+    if (r->headerDirty) {
+        fdatasync(r->fd);
+        if (pwrite(r->fd, &r->header, sizeof(RegionHeader), 0) != (ssize_t)sizeof(RegionHeader))
+            printf("RegionStore: Failed to write header of region %d,%d\n", r->regionX, r->regionZ);
+    }
+    if (r->mapped) munmap(r->mapped, r->mappedSize);
+    close(r->fd);
+    pthread_rwlock_destroy(&r->lock);
+    Memory_Free(MEM_TAG_VOXEL, r->sectorUsed);
+    Memory_Free(MEM_TAG_VOXEL, r);
+}
+
+// Missing, truncated or foreign files start over empty. Entries pointing
+// outside the file are dropped; everything else is trusted until its CRC is
+// checked on load.
+static Region* OpenRegion(RegionStore* store, int regionX, int regionZ) {
+    char path[320];
+    snprintf(path, sizeof(path), "%s/r.%d.%d.vxr", store->directory, regionX, regionZ);
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) return NULL;
+
+    Region* r = (Region*)Memory_Calloc(MEM_TAG_VOXEL, 1, sizeof(Region));
+    if (!r) {
+        close(fd);
+        return NULL;
+    }
+    r->regionX = regionX;
+    r->regionZ = regionZ;
+    r->fd = fd;
+    pthread_rwlock_init(&r->lock, NULL);
+
+    struct stat st;
+    size_t size = fstat(fd, &st) == 0 ? (size_t)st.st_size : 0;
+    bool valid = false;
+    if (size >= sizeof(RegionHeader) && MapRegion(r, size)) {
+        memcpy(&r->header, r->mapped, sizeof(RegionHeader));
+        valid = r->header.magic == REGION_MAGIC && r->header.version == REGION_VERSION &&
+                r->header.seed == store->seed;
+    }
+    if (!valid) {
+        memset(&r->header, 0, sizeof(RegionHeader));
+        r->header.magic = REGION_MAGIC;
+        r->header.version = REGION_VERSION;
+        r->header.seed = store->seed;
+        size = sizeof(RegionHeader);
+        if (ftruncate(fd, 0) != 0 || pwrite(fd, &r->header, size, 0) != (ssize_t)size || !MapRegion(r, size)) {
+            CloseRegion(r);
+            return NULL;
+        }
+    }
+
+    uint32_t fileSectors = SectorsFor(size);
+    if (!GrowSectors(r, fileSectors)) {
+        CloseRegion(r);
+        return NULL;
+    }
+    memset(r->sectorUsed, 1, REGION_HEADER_SECTORS);
+    for (int i = 0; i < REGION_CHUNKS; i++) {
+        RegionEntry* e = &r->header.entries[i];
+        if (!e->size) continue;
+        uint32_t count = SectorsFor(e->size);
+        if (e->sector < REGION_HEADER_SECTORS || e->sector + count > fileSectors ||
+            (size_t)e->sector * REGION_SECTOR + e->size > size) {
+            *e = (RegionEntry){0};
+            r->headerDirty = true;
+            continue;
+        }
+        memset(r->sectorUsed + e->sector, 1, count);
+    }
+    return r;
+}
+
+static Region* GetRegion(RegionStore* store, int regionX, int regionZ) {
+    pthread_mutex_lock(&store->regionLock);
+    Region* r = store->regions;
+    while (r && (r->regionX != regionX || r->regionZ != regionZ)) r = r->next;
+    if (!r && (r = OpenRegion(store, regionX, regionZ))) {
+        r->next = store->regions;
+        store->regions = r;
+    }
+    pthread_mutex_unlock(&store->regionLock);
+    return r;
+}
+
+// Writes the payload into free sectors and publishes it. The sectors it
+// replaces are only released once the new header is on disk.
+static void WriteChunk(RegionStore* store, RegionWrite* w) {
+    Region* r = GetRegion(store, RegionCoord(w->chunkX), RegionCoord(w->chunkZ));
+    if (!r) return;
+
+    uint32_t count = SectorsFor(w->size);
+    uint32_t first = AllocateSectors(r, count);
+    if (!first) return;
+    size_t offset = (size_t)first * REGION_SECTOR;
+    uint32_t crc = Crc32(w->data, w->size);
+    if (pwrite(r->fd, w->data, w->size, (off_t)offset) != (ssize_t)w->size) {
+        printf("RegionStore: Failed to write chunk %d,%d\n", w->chunkX, w->chunkZ);
+        memset(r->sectorUsed + first, 0, count);
+        return;
+    }
+
+    RegionEntry* e = &r->header.entries[EntryIndex(w->chunkX, w->chunkZ)];
+    RegionEntry old = *e;
+    pthread_rwlock_wrlock(&r->lock);
+    bool mapped = offset + w->size <= r->mappedSize || MapRegion(r, offset + w->size);
+    if (mapped) *e = (RegionEntry){first, (uint32_t)w->size, crc};
+    pthread_rwlock_unlock(&r->lock);
+    if (!mapped) {
+        memset(r->sectorUsed + first, 0, count);
+        return;
+    }
+
+    r->headerDirty = true;
+    w->region = r;
+    w->freeSector = old.size ? old.sector : 0;
+    w->freeCount = SectorsFor(old.size);
+    atomic_fetch_add_explicit(&store->saved, 1, memory_order_relaxed);
+}
+
+// Regions are only ever prepended and live until the store closes, so the
+// list can be walked without holding regionLock through the syncs.
+static void WriteHeaders(RegionStore* store) {
+    pthread_mutex_lock(&store->regionLock);
+    Region* regions = store->regions;
+    pthread_mutex_unlock(&store->regionLock);
+
+    for (Region* r = regions; r; r = r->next) {
+        if (!r->headerDirty) continue;
+        fdatasync(r->fd);
+        if (pwrite(r->fd, &r->header, sizeof(RegionHeader), 0) == (ssize_t)sizeof(RegionHeader))
+            r->headerDirty = false;
+        else
+            printf("RegionStore: Failed to write header of region %d,%d\n", r->regionX, r->regionZ);
+    }
+}
+
+static void* FlushMain(void* arg) {
+    RegionStore* store = (RegionStore*)arg;
+    pthread_mutex_lock(&store->queueLock);
+    for (;;) {
+        while (!store->pendingHead && !store->stopping)
+            pthread_cond_wait(&store->wake, &store->queueLock);
+        if (!store->pendingHead) break;
+        RegionWrite* first = store->pendingHead;
+        RegionWrite* last = store->pendingTail;
+        pthread_mutex_unlock(&store->queueLock);
+
+        // Writes queued after the snapshot only ever touch last->next.
+        for (RegionWrite* w = first; ; w = w->next) {
+            WriteChunk(store, w);
+            if (w == last) break;
+        }
+        WriteHeaders(store);
+
+        pthread_mutex_lock(&store->queueLock);
+        store->pendingHead = last->next;
+        if (!store->pendingHead) store->pendingTail = NULL;
+        last->next = NULL;
+        pthread_cond_broadcast(&store->drained);
+        pthread_mutex_unlock(&store->queueLock);
+
+        while (first) {
+            RegionWrite* next = first->next;
+            if (first->region && first->freeSector)
+                memset(first->region->sectorUsed + first->freeSector, 0, first->freeCount);
+            Memory_Free(MEM_TAG_VOXEL, first->data);
+            Memory_Free(MEM_TAG_VOXEL, first);
+            first = next;
+        }
+        pthread_mutex_lock(&store->queueLock);
+    }
+    pthread_mutex_unlock(&store->queueLock);
+    return NULL;
+}
+
+bool RegionStore_Open(RegionStore* store, const char* directory, int seed) {
+    *store = (RegionStore){0};
+    if (snprintf(store->directory, sizeof(store->directory), "%s/%d", directory, seed) >= (int)sizeof(store->directory))
+        return false;
+    if ((mkdir(directory, 0755) != 0 && errno != EEXIST) ||
+        (mkdir(store->directory, 0755) != 0 && errno != EEXIST)) {
+        printf("RegionStore: Failed to create %s\n", store->directory);
+        return false;
+    }
+    store->seed = seed;
+    InitCrcTable();
+
+    pthread_mutex_init(&store->regionLock, NULL);
+    pthread_mutex_init(&store->queueLock, NULL);
+    pthread_cond_init(&store->wake, NULL);
+    pthread_cond_init(&store->drained, NULL);
+    atomic_init(&store->loaded, 0);
+    atomic_init(&store->saved, 0);
+    if (pthread_create(&store->flushThread, NULL, FlushMain, store) != 0) {
+        pthread_mutex_destroy(&store->regionLock);
+        pthread_mutex_destroy(&store->queueLock);
+        pthread_cond_destroy(&store->wake);
+        pthread_cond_destroy(&store->drained);
+        return false;
+    }
+    return true;
+}
+
+// Writes everything still queued before closing the files.
+void RegionStore_Close(RegionStore* store) {
+    pthread_mutex_lock(&store->queueLock);
+    store->stopping = true;
+    pthread_cond_signal(&store->wake);
+    pthread_mutex_unlock(&store->queueLock);
+    pthread_join(store->flushThread, NULL);
+
+    while (store->regions) {
+        Region* next = store->regions->next;
+        CloseRegion(store->regions);
+        store->regions = next;
+    }
+    pthread_mutex_destroy(&store->regionLock);
+    pthread_mutex_destroy(&store->queueLock);
+    pthread_cond_destroy(&store->wake);
+    pthread_cond_destroy(&store->drained);
+}
+
+void RegionStore_Flush(RegionStore* store) {
+    pthread_mutex_lock(&store->queueLock);
+    while (store->pendingHead)
+        pthread_cond_wait(&store->drained, &store->queueLock);
+    pthread_mutex_unlock(&store->queueLock);
+}
+
+// Safe to call from any thread. Restores the chunk's blocks and columns and
+// returns the stage they were saved at, or CHUNK_EMPTY if the chunk was
+// never saved or its payload is damaged, in which case it must be generated.
+ChunkState RegionStore_Load(RegionStore* store, Chunk* c) {
+    ChunkState state = CHUNK_EMPTY;
+
+    // The newest queued write wins over whatever the file holds.
+    pthread_mutex_lock(&store->queueLock);
+    const RegionWrite* pending = NULL;
+    for (const RegionWrite* w = store->pendingHead; w; w = w->next)
+        if (w->chunkX == c->chunkX && w->chunkZ == c->chunkZ) pending = w;
+    if (pending && !DeserializeChunk(c, pending->data, pending->size, &state)) state = CHUNK_EMPTY;
+    pthread_mutex_unlock(&store->queueLock);
+
+    if (!pending) {
+        Region* r = GetRegion(store, RegionCoord(c->chunkX), RegionCoord(c->chunkZ));
+        if (!r) return CHUNK_EMPTY;
+
+        pthread_rwlock_rdlock(&r->lock);
+        const RegionEntry* e = &r->header.entries[EntryIndex(c->chunkX, c->chunkZ)];
+        if (e->size) {
+            const uint8_t* data = r->mapped + (size_t)e->sector * REGION_SECTOR;
+            if (Crc32(data, e->size) != e->crc || !DeserializeChunk(c, data, e->size, &state))
+                state = CHUNK_EMPTY;
+        }
+        pthread_rwlock_unlock(&r->lock);
+    }
+    if (state != CHUNK_EMPTY) atomic_fetch_add_explicit(&store->loaded, 1, memory_order_relaxed);
+    return state;
+}
+
+// Queues the chunk for writing if it got further than its last save. Busy
+// chunks and chunks without terrain are skipped. Meshes are not stored, so
+// a meshed chunk is saved as lit and meshed again when it comes back.
+bool RegionStore_Save(RegionStore* store, Chunk* c) {
+    if (!store || c->busy || c->state < CHUNK_TERRAIN) return false;
+    ChunkState state = c->state > CHUNK_LIT ? CHUNK_LIT : c->state;
+    if (state <= c->savedState) return true;
+
+    RegionWrite* w = (RegionWrite*)Memory_Calloc(MEM_TAG_VOXEL, 1, sizeof(RegionWrite));
+    if (!w) return false;
+    w->data = SerializeChunk(c, state, &w->size);
+    if (!w->data) {
+        Memory_Free(MEM_TAG_VOXEL, w);
+        return false;
+    }
+    w->chunkX = c->chunkX;
+    w->chunkZ = c->chunkZ;
+
+    pthread_mutex_lock(&store->queueLock);
+    if (store->pendingTail) store->pendingTail->next = w;
+    else store->pendingHead = w;
+    store->pendingTail = w;
+    pthread_cond_signal(&store->wake);
+    pthread_mutex_unlock(&store->queueLock);
+
+    c->savedState = state;
+    return true;
+}
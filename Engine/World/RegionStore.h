@@ -0,0 +1,91 @@
+#ifndef REGIONSTORE_H
+#define REGIONSTORE_H
+#include "Block.h"
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define REGION_SIZE 32
+#define REGION_CHUNKS (REGION_SIZE * REGION_SIZE)
+#define REGION_SECTOR 1024
+
+// Where a chunk's payload lives in its region file. size is 0 for chunks
+// that were never written; crc is the CRC-32 of the payload.
+typedef struct {
+    uint32_t sector;
+    uint32_t size;
+    uint32_t crc;
+} RegionEntry;
+
+// Start of every region file, followed by payloads aligned to
+// REGION_SECTOR. entries is indexed by (chunkZ & 31) * 32 + (chunkX & 31).
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    int32_t seed;
+    uint32_t reserved;
+    RegionEntry entries[REGION_CHUNKS];
+} RegionHeader;
+
+// One open region file. Readers take lock shared, decode straight out of the
+// mapping and look entries up in the header copy; the flush thread takes it
+// exclusively to publish a new entry or remap a grown file. sectorUsed is
+// only touched by the flush thread.
+typedef struct Region {
+    int regionX;
+    int regionZ;
+    int fd;
+    pthread_rwlock_t lock;
+    uint8_t* mapped;
+    size_t mappedSize;
+    RegionHeader header;
+    uint8_t* sectorUsed;
+    uint32_t sectorCount;
+    bool headerDirty;
+    struct Region* next;
+} Region;
+
+// A queued save. region and the sectors to free are filled in by the flush
+// thread once the payload is written.
+typedef struct RegionWrite {
+    int chunkX;
+    int chunkZ;
+    uint8_t* data;
+    size_t size;
+    Region* region;
+    uint32_t freeSector;
+    uint32_t freeCount;
+    struct RegionWrite* next;
+} RegionWrite;
+
+// On-disk chunk store: one file per 32x32 chunk columns under
+// <directory>/<seed>/. Saves are serialized on the calling thread and queued;
+// a background thread writes each batch into free sectors, syncs, and only
+// then rewrites the headers it touched, so the header on disk never points
+// at a half-written payload. Queued writes stay visible to loads until they
+// are published.
+typedef struct RegionStore {
+    char directory[256];
+    int seed;
+
+    pthread_mutex_t regionLock;
+    Region* regions;
+
+    pthread_mutex_t queueLock;
+    pthread_cond_t wake;
+    pthread_cond_t drained;
+    RegionWrite* pendingHead;
+    RegionWrite* pendingTail;
+    bool stopping;
+    pthread_t flushThread;
+
+    atomic_int loaded;
+    atomic_int saved;
+} RegionStore;
+
+bool RegionStore_Open(RegionStore* store, const char* directory, int seed);
+void RegionStore_Close(RegionStore* store);
+ChunkState RegionStore_Load(RegionStore* store, Chunk* c);
+bool RegionStore_Save(RegionStore* store, Chunk* c);
+void RegionStore_Flush(RegionStore* store);
+
+#endif
@@ -1,4 +1,5 @@
 #include "text.h"
+#include "../Memory.h"
 #include <SDL3/SDL_error.h>
 #include <SDL3_ttf/SDL_ttf.h>
 #include <string.h>
@@ -43,6 +44,7 @@ TextTexture CreateTextTexture(TTF_Font* font, const char* text, SDL_Color color)
     glBindTexture(GL_TEXTURE_2D, tex.texture);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, tex.width, tex.height, 0,
                  GL_RGBA, GL_UNSIGNED_BYTE, rgbaSurface->pixels);
+    Memory_TrackGL(MEM_GL_TEXTURE, tex.texture, MEM_TAG_UI, (size_t)tex.width * tex.height * 4);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
@@ -55,6 +57,7 @@ TextTexture CreateTextTexture(TTF_Font* font, const char* text, SDL_Color color)
 
     float vertices[6*4] = {0};
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_DYNAMIC_DRAW);
+    Memory_TrackGL(MEM_GL_BUFFER, tex.VBO, MEM_TAG_UI, sizeof(vertices));
 
     glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
@@ -101,8 +104,14 @@ void RenderTextTexture(shader* s, TextTexture* tex, float x, float y, int screen
 }
 
 void FreeTextTexture(TextTexture* tex) {
-    if (tex->texture) glDeleteTextures(1, &tex->texture);
-    if (tex->VBO) glDeleteBuffers(1, &tex->VBO);
+    if (tex->texture) {
+        Memory_UntrackGL(MEM_GL_TEXTURE, tex->texture);
+        glDeleteTextures(1, &tex->texture);
+    }
+    if (tex->VBO) {
+        Memory_UntrackGL(MEM_GL_BUFFER, tex->VBO);
+        glDeleteBuffers(1, &tex->VBO);
+    }
     if (tex->VAO) glDeleteVertexArrays(1, &tex->VAO);
 }
 
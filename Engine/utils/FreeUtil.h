@@ -2,9 +2,12 @@
 #define FREE_UTIL
 
 #include <GL/glew.h>
+#include "../Memory.h"
 #include "../Shaderer.h"
 
 void FreeShader(int size, GLuint* buffers, shader* shader) {
+  for (int i = 0; i < size; i++)
+    Memory_UntrackGL(MEM_GL_BUFFER, buffers[i]);
   glDeleteBuffers(size, buffers);
   glDeleteVertexArrays(size, buffers);
   Shader_Destroy(shader);
@@ -2,6 +2,7 @@
 #define MATHUTIL_H
 
 #include <math.h>
+#include <stdbool.h>
 
 typedef struct { float x, y, z; } vec3;
 typedef struct { float m[16]; } mat4;
@@ -122,4 +123,36 @@ static mat4 Ortho(float left, float right, float bottom, float top, float near,
     }};
 }
 
+// Planes are stored as (a, b, c, d) with a*x + b*y + c*z + d >= 0 inside.
+typedef struct { vec4 planes[6]; } Frustum;
+
+// Extracts the six clip planes from a combined projection * view matrix.
+static Frustum FrustumFromMatrix(mat4 m) {
+    Frustum f;
+    for (int i = 0; i < 3; i++) {
+        for (int side = 0; side < 2; side++) {
+            float s = side ? -1.0f : 1.0f;
+            f.planes[i*2 + side] = (vec4){
+                m.m[3]  + s*m.m[i],
+                m.m[7]  + s*m.m[4 + i],
+                m.m[11] + s*m.m[8 + i],
+                m.m[15] + s*m.m[12 + i]
+            };
+        }
+    }
+    return f;
+}
+
+// Conservative test: only rejects boxes entirely behind one plane.
+static bool FrustumIntersectsAABB(const Frustum* f, vec3 min, vec3 max) {
+    for (int i = 0; i < 6; i++) {
+        vec4 p = f->planes[i];
+        float x = p.x > 0 ? max.x : min.x;
+        float y = p.y > 0 ? max.y : min.y;
+        float z = p.z > 0 ? max.z : min.z;
+        if (p.x*x + p.y*y + p.z*z + p.w < 0) return false;
+    }
+    return true;
+}
+
 #endif
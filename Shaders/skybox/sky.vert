@@ -4,10 +4,19 @@ layout(location = 1) in vec3 aColor;
 
 out vec3 vColor;
 
-uniform mat4 view;
-uniform mat4 projection;
+layout(std140) uniform FrameUniforms {
+    mat4 view;
+    mat4 projection;
+    vec4 viewPos;
+    vec4 lightDirection;
+    vec4 lightColor;
+    vec4 lightParams;
+    vec4 fogColor;
+    vec4 fogRange;
+};
 
 void main() {
     vColor = aColor;
-    gl_Position = projection * view * vec4(aPos, 1.0);
+    // The dome follows the camera, so only the rotation of view applies.
+    gl_Position = projection * mat4(mat3(view)) * vec4(aPos, 1.0);
 }
@@ -6,42 +6,42 @@ in vec3 Normal;
 in vec3 Color;
 in float AO;
 
-struct DirectionalLight {
-    vec3 direction;
-    vec3 color;
-    float ambient;
-    float diffuse;
-    float specular;
+layout(std140) uniform FrameUniforms {
+    mat4 view;
+    mat4 projection;
+    vec4 viewPos;
+    vec4 lightDirection;
+    vec4 lightColor;
+    vec4 lightParams;
+    vec4 fogColor;
+    vec4 fogRange;
 };
 
-uniform DirectionalLight dirLight;
-uniform vec3 viewPos;
+// lightParams holds the ambient, diffuse and specular strengths, fogRange the
+// distances where fog starts and where it is opaque.
 
 void main() {
     vec3 norm = normalize(Normal);
-    vec3 lightDir = normalize(-dirLight.direction);
+    vec3 lightDir = normalize(-lightDirection.xyz);
 
     float diff = max(dot(norm, lightDir), 0.0);
 
-    vec3 viewDir = normalize(viewPos - FragPos);
+    vec3 viewDir = normalize(viewPos.xyz - FragPos);
     vec3 reflectDir = reflect(-lightDir, norm);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32.0);
 
-    vec3 ambient = dirLight.ambient * dirLight.color;
-    vec3 diffuse = dirLight.diffuse * diff * dirLight.color;
-    vec3 specular = dirLight.specular * spec * dirLight.color;
+    vec3 ambient = lightParams.x * lightColor.rgb;
+    vec3 diffuse = lightParams.y * diff * lightColor.rgb;
+    vec3 specular = lightParams.z * spec * lightColor.rgb;
 
     vec3 lighting = (ambient + diffuse + specular * 0.3);
 
     vec3 result = Color * lighting * AO;
 
-    float distance = length(viewPos - FragPos);
-    float fogStart = 20.0;
-    float fogEnd = 32.0;
-    float fogFactor = clamp((fogEnd - distance) / (fogEnd - fogStart), 0.0, 1.0);
-    vec3 fogColor = vec3(0.7, 0.85, 0.95);
+    float distance = length(viewPos.xyz - FragPos);
+    float fogFactor = clamp((fogRange.y - distance) / (fogRange.y - fogRange.x), 0.0, 1.0);
 
-    result = mix(fogColor, result, fogFactor);
+    result = mix(fogColor.rgb, result, fogFactor);
 
     FragColor = vec4(result, 1.0);
 }
@@ -1,22 +1,40 @@
 #version 330 core
-layout(location = 0) in vec3 aPos;
-layout(location = 1) in vec3 aNormal;
-layout(location = 2) in vec3 aColor;
-layout(location = 3) in float aAO;
+layout(location = 0) in uvec2 aPacked;
+layout(location = 1) in vec3 chunkOrigin;
 
 out vec3 FragPos;
 out vec3 Normal;
 out vec3 Color;
 out float AO;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+uniform float voxelSize;
+uniform vec3 blockPalette[16];
+
+layout(std140) uniform FrameUniforms {
+    mat4 view;
+    mat4 projection;
+    vec4 viewPos;
+    vec4 lightDirection;
+    vec4 lightColor;
+    vec4 lightParams;
+    vec4 fogColor;
+    vec4 fogRange;
+};
+
+const vec3 faceNormals[6] = vec3[6](
+    vec3(0, 0, 1), vec3(0, 0, -1), vec3(-1, 0, 0),
+    vec3(1, 0, 0), vec3(0, 1, 0), vec3(0, -1, 0)
+);
+const float aoLevels[4] = float[4](1.0, 0.82, 0.64, 0.2);
 
 void main() {
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;
-    Color = aColor;
-    AO = aAO;
+    uvec3 corner = uvec3(aPacked.x, aPacked.x >> 6u, aPacked.x >> 12u) & 63u;
+    uint face = (aPacked.x >> 18u) & 7u;
+    uint ao = (aPacked.x >> 21u) & 3u;
+
+    FragPos = chunkOrigin + (vec3(corner) - 0.5) * voxelSize;
+    Normal = faceNormals[face];
+    Color = blockPalette[aPacked.y & 0xFFFFu];
+    AO = aoLevels[ao];
     gl_Position = projection * view * vec4(FragPos, 1.0);
 }
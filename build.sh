@@ -1,5 +1,5 @@
 #!/bin/sh
 
-gcc main.c -lGL -lSDL3 -ldl -lm -lGLEW -lSDL3_image -lGLU -lSDL3_ttf -o main
+gcc main.c -lGL -lSDL3 -ldl -lm -lGLEW -lSDL3_image -lGLU -lSDL3_ttf -lEGL -lpthread -o main
 
 ./main
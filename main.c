@@ -1,17 +1,42 @@
 #include <SDL3/SDL_main.h>
+#include "Engine/Headless.h"
 #include "Engine/Window.h"
+#include <string.h>
 
 //Unity build;
 #include "Engine/Window.c"
+#include "Engine/Scene.c"
+#include "Engine/Headless.c"
+#include "Engine/Benchmark.c"
+#include "Engine/Verify.c"
 #include "Engine/Renderer.c"
+#include "Engine/MeshArena.c"
+#include "Engine/Profiler.c"
+#include "Engine/Memory.c"
 #include "Engine/Camera.c"
 #include "Engine/Shaderer.c"
+#include "Engine/World/BlockStorage.c"
+#include "Engine/World/ChunkMap.c"
+#include "Engine/World/ChunkPool.c"
+#include "Engine/World/Noise.c"
 #include "Engine/World/Block.c"
+#include "Engine/World/RegionStore.c"
+#include "Engine/World/ChunkWorkers.c"
+#include "Engine/World/ChunkCache.c"
 #include "Engine/World/Lighting.c"
 #include "Engine/ui/text.c"
 #include "Engine/Player/Player.c"
 
 int main(int argc, char *argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--headless") == 0 || strncmp(argv[i], "--verify-", 9) == 0 ||
+            strcmp(argv[i], "--bench") == 0) {
+            HeadlessOptions options;
+            if (!Headless_ParseArgs(argc, argv, &options)) return 1;
+            return Headless_Run(&options);
+        }
+    }
+
     CreateWindow("Engine", 1920, 1920);
     return 0;
 }